@@ -2,9 +2,254 @@
 
 #pragma once
 
+#include <cmath>
+#include <cstring>
 #include <limits>
+#include <stdint.h>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace akt {
+  /*
+   * Block reductions for Extrema::add_block() and MaxMinMean::add_block().
+   * BlockLanes<T> describes the widest vector registers the target has for
+   * T: how many samples fit in one, and how to load, compare and sum them.
+   * x86 hosts use AVX/AVX2 or SSE2 (SSE4.1 for 32-bit integer compares,
+   * when enabled), and the Cortex-M4 compares and sums int16_t samples two
+   * at a time with the DSP extension. Types without a specialization, and
+   * the samples left over at the end of a block, are reduced one at a time.
+   */
+  template<class T> struct BlockLanes {
+    enum {WIDTH = 1};
+  };
+
+#if defined(__AVX2__)
+  template<> struct BlockLanes<int16_t> {
+    enum {WIDTH = 16, SUM_WIDTH = 8};
+    typedef __m256i V;
+    typedef __m256i SumV;
+    typedef int32_t SumLane;
+
+    static V load(const int16_t *x) {return _mm256_loadu_si256((const __m256i *) x);}
+    static V min(V a, V b) {return _mm256_min_epi16(a, b);}
+    static V max(V a, V b) {return _mm256_max_epi16(a, b);}
+    static void store(int16_t *x, V v) {_mm256_storeu_si256((__m256i *) x, v);}
+
+    static SumV zero() {return _mm256_setzero_si256();}
+    static SumV accumulate(SumV sum, V v) {return _mm256_add_epi32(sum, _mm256_madd_epi16(v, _mm256_set1_epi16(1)));}
+    static void store(SumLane *x, SumV v) {_mm256_storeu_si256((__m256i *) x, v);}
+  };
+
+  template<> struct BlockLanes<int32_t> {
+    enum {WIDTH = 8, SUM_WIDTH = 4};
+    typedef __m256i V;
+    typedef __m256i SumV;
+    typedef int64_t SumLane;
+
+    static V load(const int32_t *x) {return _mm256_loadu_si256((const __m256i *) x);}
+    static V min(V a, V b) {return _mm256_min_epi32(a, b);}
+    static V max(V a, V b) {return _mm256_max_epi32(a, b);}
+    static void store(int32_t *x, V v) {_mm256_storeu_si256((__m256i *) x, v);}
+
+    // sign extended to 64-bit lanes, since two full scale samples overflow 32 bits
+    static SumV zero() {return _mm256_setzero_si256();}
+    static SumV accumulate(SumV sum, V v) {
+      sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+      return _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+    }
+    static void store(SumLane *x, SumV v) {_mm256_storeu_si256((__m256i *) x, v);}
+  };
+#elif defined(__SSE2__)
+  template<> struct BlockLanes<int16_t> {
+    enum {WIDTH = 8, SUM_WIDTH = 4};
+    typedef __m128i V;
+    typedef __m128i SumV;
+    typedef int32_t SumLane;
+
+    static V load(const int16_t *x) {return _mm_loadu_si128((const __m128i *) x);}
+    static V min(V a, V b) {return _mm_min_epi16(a, b);}
+    static V max(V a, V b) {return _mm_max_epi16(a, b);}
+    static void store(int16_t *x, V v) {_mm_storeu_si128((__m128i *) x, v);}
+
+    static SumV zero() {return _mm_setzero_si128();}
+    static SumV accumulate(SumV sum, V v) {return _mm_add_epi32(sum, _mm_madd_epi16(v, _mm_set1_epi16(1)));}
+    static void store(SumLane *x, SumV v) {_mm_storeu_si128((__m128i *) x, v);}
+  };
+
+  template<> struct BlockLanes<int32_t> {
+    enum {WIDTH = 4, SUM_WIDTH = 2};
+    typedef __m128i V;
+    typedef __m128i SumV;
+    typedef int64_t SumLane;
+
+    static V load(const int32_t *x) {return _mm_loadu_si128((const __m128i *) x);}
+#if defined(__SSE4_1__)
+    static V min(V a, V b) {return _mm_min_epi32(a, b);}
+    static V max(V a, V b) {return _mm_max_epi32(a, b);}
+#else
+    static V select(V mask, V a, V b) {return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));}
+    static V min(V a, V b) {return select(_mm_cmplt_epi32(a, b), a, b);}
+    static V max(V a, V b) {return select(_mm_cmpgt_epi32(a, b), a, b);}
+#endif
+    static void store(int32_t *x, V v) {_mm_storeu_si128((__m128i *) x, v);}
+
+    // sign extended to 64-bit lanes by interleaving with the sign bits
+    static SumV zero() {return _mm_setzero_si128();}
+    static SumV accumulate(SumV sum, V v) {
+      V sign = _mm_srai_epi32(v, 31);
+      sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(v, sign));
+      return _mm_add_epi64(sum, _mm_unpackhi_epi32(v, sign));
+    }
+    static void store(SumLane *x, SumV v) {_mm_storeu_si128((__m128i *) x, v);}
+  };
+#elif defined(__ARM_FEATURE_SIMD32)
+  template<> struct BlockLanes<int16_t> {
+    enum {WIDTH = 2, SUM_WIDTH = 1};
+    typedef uint32_t V; // two samples
+    typedef int32_t SumV;
+    typedef int32_t SumLane;
+
+    static V load(const int16_t *x) {
+      V v;
+      memcpy(&v, x, sizeof(v));
+      return v;
+    }
+
+    // SSUB16 sets a GE flag for each half where a >= b, which SEL uses
+    static V min(V a, V b) {
+      V r, scratch;
+      asm("ssub16 %1, %2, %3\n\t"
+          "sel %0, %3, %2" : "=r"(r), "=&r"(scratch) : "r"(a), "r"(b) : "cc");
+      return r;
+    }
+
+    static V max(V a, V b) {
+      V r, scratch;
+      asm("ssub16 %1, %2, %3\n\t"
+          "sel %0, %2, %3" : "=r"(r), "=&r"(scratch) : "r"(a), "r"(b) : "cc");
+      return r;
+    }
+
+    static void store(int16_t *x, V v) {memcpy(x, &v, sizeof(v));}
+
+    static SumV zero() {return 0;}
+
+    // both halves times one, added to the sum
+    static SumV accumulate(SumV sum, V v) {
+      asm("smlad %0, %1, %2, %0" : "+r"(sum) : "r"(v), "r"(0x00010001));
+      return sum;
+    }
+
+    static void store(SumLane *x, SumV v) {*x = v;}
+  };
+#endif
+
+#if defined(__AVX__)
+  template<> struct BlockLanes<float> {
+    enum {WIDTH = 8, SUM_WIDTH = 8};
+    typedef __m256 V;
+    typedef __m256 SumV;
+    typedef float SumLane;
+
+    static V load(const float *x) {return _mm256_loadu_ps(x);}
+    static V min(V a, V b) {return _mm256_min_ps(a, b);}
+    static V max(V a, V b) {return _mm256_max_ps(a, b);}
+    static void store(float *x, V v) {_mm256_storeu_ps(x, v);}
+
+    static SumV zero() {return _mm256_setzero_ps();}
+    static SumV accumulate(SumV sum, V v) {return _mm256_add_ps(sum, v);}
+  };
+#elif defined(__SSE2__)
+  template<> struct BlockLanes<float> {
+    enum {WIDTH = 4, SUM_WIDTH = 4};
+    typedef __m128 V;
+    typedef __m128 SumV;
+    typedef float SumLane;
+
+    static V load(const float *x) {return _mm_loadu_ps(x);}
+    static V min(V a, V b) {return _mm_min_ps(a, b);}
+    static V max(V a, V b) {return _mm_max_ps(a, b);}
+    static void store(float *x, V v) {_mm_storeu_ps(x, v);}
+
+    static SumV zero() {return _mm_setzero_ps();}
+    static SumV accumulate(SumV sum, V v) {return _mm_add_ps(sum, v);}
+  };
+#endif
+
+  template<class T, unsigned Width = BlockLanes<T>::WIDTH>
+    struct BlockReduce {
+      typedef BlockLanes<T> L;
+
+      // the smallest and largest of x[0..n), n > 0
+      static void extrema(const T *x, unsigned n, T &lo, T &hi) {
+        unsigned i = 0;
+
+        lo = hi = x[0];
+        if (n >= Width) {
+          typename L::V vlo = L::load(x), vhi = vlo;
+          T lanes[Width];
+
+          for (i=Width; i + Width <= n; i += Width) {
+            typename L::V v = L::load(x + i);
+            vlo = L::min(vlo, v);
+            vhi = L::max(vhi, v);
+          }
+
+          L::store(lanes, vlo);
+          for (unsigned j=0; j < Width; ++j) if (lanes[j] < lo) lo = lanes[j];
+          L::store(lanes, vhi);
+          for (unsigned j=0; j < Width; ++j) if (lanes[j] > hi) hi = lanes[j];
+        }
+
+        for (; i < n; ++i) {
+          if (x[i] < lo) lo = x[i];
+          if (x[i] > hi) hi = x[i];
+        }
+      }
+
+      // Integer lanes have room for ROUNDS full scale samples each
+      // (int16_t pairs are summed into 32 bits, int32_t is widened to 64)
+      // and are emptied into total after that, so they can't overflow.
+      template<class S> static S sum(const T *x, unsigned n, S total) {
+        enum {ROUNDS = 4096};
+        unsigned i = 0;
+
+        while (i + Width <= n) {
+          typename L::SumV v = L::zero();
+          typename L::SumLane lanes[L::SUM_WIDTH];
+
+          for (unsigned r=0; r < ROUNDS && i + Width <= n; ++r, i += Width) {
+            v = L::accumulate(v, L::load(x + i));
+          }
+
+          L::store(lanes, v);
+          for (unsigned j=0; j < L::SUM_WIDTH; ++j) total += lanes[j];
+        }
+
+        for (; i < n; ++i) total += x[i];
+        return total;
+      }
+    };
+
+  template<class T>
+    struct BlockReduce<T, 1> {
+      static void extrema(const T *x, unsigned n, T &lo, T &hi) {
+        lo = hi = x[0];
+        for (unsigned i=1; i < n; ++i) {
+          if (x[i] < lo) lo = x[i];
+          if (x[i] > hi) hi = x[i];
+        }
+      }
+
+      template<class S> static S sum(const T *x, unsigned n, S total) {
+        for (unsigned i=0; i < n; ++i) total += x[i];
+        return total;
+      }
+    };
+
   template<class T>
     struct Extrema {
       struct {
@@ -18,7 +263,7 @@ namespace akt {
       Extrema() {reset();}
 
       void reset() {
-        max.value = std::numeric_limits<T>::min();
+        max.value = std::numeric_limits<T>::lowest();
         max.index = -1;
         min.value = std::numeric_limits<T>::max();
         min.index = -1;
@@ -39,11 +284,246 @@ namespace akt {
         count += 1;
         return *this;
       }
+      /**
+       * Same as adding each of x[0..n) in turn, including the indices,
+       * which refer to the last occurrence of the maximum and minimum.
+       * Floating point samples mustn't be NaN.
+       */
+      Extrema &add_block(const T *x, unsigned n) {
+        if (n == 0) return *this;
+
+        T lo, hi;
+        BlockReduce<T>::extrema(x, n, lo, hi);
+
+        if (hi >= max.value) {
+          unsigned i = n - 1;
+          while (!(x[i] == hi)) --i;
+          max.value = x[i];
+          max.index = count + i;
+        }
+
+        if (lo <= min.value) {
+          unsigned i = n - 1;
+          while (!(x[i] == lo)) --i;
+          min.value = x[i];
+          min.index = count + i;
+        }
+
+        count += n;
+        return *this;
+      }
+
+      // as if other's samples had been added after these
+      Extrema &operator+=(const Extrema &other) {
+        if (other.count == 0) return *this;
+
+        if (other.max.value >= max.value) {
+          max.value = other.max.value;
+          max.index = count + other.max.index;
+        }
+
+        if (other.min.value <= min.value) {
+          min.value = other.min.value;
+          min.index = count + other.min.index;
+        }
+
+        count += other.count;
+        return *this;
+      }
     };
 
+  /**
+   * Variance accumulates the mean and variance of a stream with Welford's
+   * method, which doesn't lose precision to the cancellation that summing
+   * squares does. Two accumulators can be merged with += (Chan et al.), so
+   * per-block or per-thread statistics combine cheaply. Results are
+   * floats.
+   *
+   * For floating point and 32-bit samples the running mean and sum of
+   * squared deviations are doubles. In single precision the per-sample
+   * corrections fall below an ulp after a few million samples and the
+   * variance decays. Doubles are done in software on the Cortex-M4.
+   *
+   * Integer samples of up to 16 bits use a fixed-point variant: the mean
+   * is kept in 32 bits with 29 - digits fraction bits (14 for int16_t), so
+   * that a sample's deviation from it fits in 31, and the sum of squared
+   * deviations in 64 bits with 4 fraction bits. Full scale noise takes over
+   * 2^30 samples to overflow it. Updates need one 32-bit divide.
+   */
+  template<class T, bool Fixed = std::is_integral<T>::value && sizeof(T) <= 2>
+    class Variance;
+
   template<class T>
+    class Variance<T, false> {
+    typedef typename std::conditional<std::is_integral<T>::value, int64_t, T>::type Wide;
+
+    static double difference(T a, T b) {return (double) ((Wide) a - (Wide) b);}
+
+  public:
+    // Deviations are taken from the first sample, so that large offsets
+    // don't swamp them.
+    unsigned count;
+    T pivot;
+    double average, m2; // of samples - pivot, m2 is the sum of squared deviations
+
+    Variance() {reset();}
+
+    void reset() {
+      count = 0;
+      pivot = 0;
+      average = m2 = 0;
+    }
+
+    Variance &operator+=(T sample) {
+      if (count == 0) pivot = sample;
+
+      double x = difference(sample, pivot), delta = x - average;
+
+      count += 1;
+      average += delta/count;
+      m2 += delta*(x - average);
+
+      return *this;
+    }
+
+    Variance &operator+=(const Variance &other) {
+      if (other.count == 0) return *this;
+      if (count == 0) return *this = other;
+
+      unsigned n = count + other.count;
+      double delta = difference(other.pivot, pivot) + other.average - average;
+
+      average += delta*other.count/n;
+      m2 += other.m2 + delta*delta*((double) count*other.count/n);
+      count = n;
+
+      return *this;
+    }
+
+    // two passes over the block, around its own mean, then a merge
+    template<class S> Variance &add_block(const T *x, unsigned n, S sum) {
+      if (n == 0) return *this;
+
+      Variance block;
+      block.count = n;
+      block.pivot = x[0];
+      block.average = (double) (sum - (S) n*x[0])/n;
+      for (unsigned i=0; i < n; ++i) {
+        double d = difference(x[i], block.pivot) - block.average;
+        block.m2 += d*d;
+      }
+
+      return *this += block;
+    }
+
+    float mean() const {return (float) (pivot + average);}
+    float variance() const {return count ? (float) (m2/count) : 0;}
+    float sample_variance() const {return count > 1 ? (float) (m2/(count - 1)) : 0;}
+    float stddev() const {return sqrtf(variance());}
+  };
+
+  template<class T>
+    class Variance<T, true> {
+    enum {
+      MEAN_BITS = 29 - std::numeric_limits<T>::digits, // fraction bits of average
+      M2_BITS = 4,                                      // and of m2
+      SHIFT = 2*MEAN_BITS - M2_BITS                     // from squared averages to m2
+    };
+
+    // rounded, a and b/2 must fit in 31 bits
+    static int32_t divide(int32_t a, int32_t b) {
+      return (a + (a < 0 ? -b : b)/2)/b;
+    }
+
+    static int64_t divide(int64_t a, int64_t b) {
+      return (a + (a < 0 ? -b : b)/2)/b;
+    }
+
+    static int64_t narrow(int64_t square) {
+      return (square + (1ll << (SHIFT - 1))) >> SHIFT;
+    }
+
+  public:
+    unsigned count;
+    int32_t average;
+    int64_t m2;
+
+    Variance() {reset();}
+
+    void reset() {
+      count = 0;
+      average = 0;
+      m2 = 0;
+    }
+
+    Variance &operator+=(T sample) {
+      int32_t x = (int32_t) sample * (1 << MEAN_BITS);
+      int32_t delta = x - average;
+
+      count += 1;
+      average += divide(delta, (int32_t) count);
+      m2 += narrow((int64_t) delta*(x - average));
+
+      return *this;
+    }
+
+    Variance &operator+=(const Variance &other) {
+      if (other.count == 0) return *this;
+
+      unsigned n = count + other.count;
+      int64_t delta = (int64_t) other.average - average;
+
+      average += divide(delta*other.count, (int64_t) n);
+      m2 += other.m2 + (int64_t) ((float) delta*delta*((float) count*other.count/n) / (float) (1ll << SHIFT));
+      count = n;
+
+      return *this;
+    }
+
+    template<class S> Variance &add_block(const T *x, unsigned n, S sum) {
+      if (n == 0) return *this;
+
+      Variance block;
+      block.count = n;
+      block.average = divide((int64_t) sum * (1 << MEAN_BITS), (int64_t) n);
+      for (unsigned i=0; i < n; ++i) {
+        int64_t d = (int32_t) x[i] * (1 << MEAN_BITS) - block.average;
+        block.m2 += narrow(d*d);
+      }
+
+      return *this += block;
+    }
+
+    float mean() const {return (float) average / (1 << MEAN_BITS);}
+    float variance() const {return count ? (float) m2 / (1 << M2_BITS) / count : 0;}
+    float sample_variance() const {return count > 1 ? (float) m2 / (1 << M2_BITS) / (count - 1) : 0;}
+    float stddev() const {return sqrtf(variance());}
+  };
+
+  // stands in for Variance in a MaxMinMean that doesn't track it
+  template<class T>
+    struct NoVariance {
+      void reset() {}
+      NoVariance &operator+=(T) {return *this;}
+      NoVariance &operator+=(const NoVariance &) {return *this;}
+      template<class S> NoVariance &add_block(const T *, unsigned, S) {return *this;}
+    };
+
+  /**
+   * MaxMinMean adds a sum to Extrema, for the mean. With Spread it also
+   * keeps a Variance, which costs a divide per sample, so it's opt-in:
+   *
+   *   MaxMinMean<int16_t, true> stats;
+   *   float sd = stats.stddev();
+   */
+  template<class T, bool Spread = false>
     struct MaxMinMean : public Extrema<T> {
-    decltype (Extrema<T>::max.value + Extrema<T>::min.value) sum;
+    // integer sums are 64 bits, so long runs of samples can't overflow them
+    typedef typename std::conditional<std::is_integral<T>::value,
+                                      int64_t,
+                                      decltype(T() + T())>::type Sum;
+    Sum sum;
+    typename std::conditional<Spread, Variance<T>, NoVariance<T> >::type spread;
 
   public:
     MaxMinMean() :
@@ -55,6 +535,26 @@ namespace akt {
     MaxMinMean &operator+=(T value) {
       Extrema<T>::operator+=(value);
       sum += value;
+      spread += value;
+
+      return *this;
+    }
+
+    // floating point sums are added in a different order than one at a time
+    MaxMinMean &add_block(const T *x, unsigned n) {
+      Sum block_sum = BlockReduce<T>::sum(x, n, (Sum) 0);
+
+      Extrema<T>::add_block(x, n);
+      sum += block_sum;
+      spread.add_block(x, n, block_sum);
+
+      return *this;
+    }
+
+    MaxMinMean &operator+=(const MaxMinMean &other) {
+      Extrema<T>::operator+=(other);
+      sum += other.sum;
+      spread += other.spread;
 
       return *this;
     }
@@ -62,12 +562,23 @@ namespace akt {
     void reset() {
       Extrema<T>::reset();
       sum = 0;
+      spread.reset();
       this->count = 0;
     }
 
+    float variance() const {
+      static_assert(Spread, "declare MaxMinMean<T, true> for variance()");
+      return spread.variance();
+    }
+
+    float stddev() const {
+      static_assert(Spread, "declare MaxMinMean<T, true> for stddev()");
+      return spread.stddev();
+    }
+
     T range() const {return this->max.value - this->min.value;}
     T mean() const {return this->sum/this->count;}
-    T median() const {return this->min.value + range()/2;}
+    T midrange() const {return this->min.value + range()/2;} // see Quantile for a median
 
     T truncated_mean() const {
       switch (this->count) {
@@ -122,4 +633,249 @@ namespace akt {
     }
   };
 
+  /**
+   * Quantile estimates one quantile of a stream, e.g., the median, in
+   * constant memory using the P-squared algorithm (Jain and Chlamtac,
+   * 1985). Five markers track the minimum, the quantile, the maximum and
+   * the points halfway between, and are nudged along a parabola fitted
+   * through their neighbours as samples arrive. The minimum and maximum
+   * are exact, and the estimate is exact for the first five samples.
+   *
+   *   Quantile<int16_t> median(0.5f), p90(0.9f);
+   *   for (...) {median += x; p90 += x;}
+   *   int16_t m = median.value();
+   *
+   * Marker values are floats, which the Cortex-M4 FPU does in hardware.
+   * Where the markers should be is worked out from the sample count each
+   * time, in 64-bit fixed point with 31 fraction bits, rather than summed
+   * in floats, which drift and then stop growing after a few million
+   * samples. Good for up to 2^31 samples.
+   */
+  template<class T>
+    class Quantile {
+    float quantile;
+    float heights[5];      // marker values
+    int positions[5];      // marker ranks, from 1
+    int64_t increments[5]; // how far the markers should move per sample, Q31
+    unsigned count;
+
+    static T to_sample(float x) {
+      return std::is_integral<T>::value ? (T) floorf(x + 0.5f) : (T) x;
+    }
+
+    float parabolic(int i, int d) const {
+      float n_below = positions[i] - positions[i-1];
+      float n_above = positions[i+1] - positions[i];
+
+      return heights[i] + d/(float) (positions[i+1] - positions[i-1]) *
+        ((n_below + d)*(heights[i+1] - heights[i])/n_above +
+         (n_above - d)*(heights[i] - heights[i-1])/n_below);
+    }
+
+    float linear(int i, int d) const {
+      return heights[i] + d*(heights[i+d] - heights[i])/(positions[i+d] - positions[i]);
+    }
+
+  public:
+    Quantile(float q = 0.5f) : quantile(q) {reset();}
+
+    void reset() {
+      const int64_t q = (int64_t) ((double) quantile * (1ll << 31) + 0.5);
+
+      for (int i=0; i < 5; ++i) positions[i] = i + 1;
+
+      // the desired positions are 1 + (count - 1)*increments
+      increments[0] = 0;
+      increments[1] = q/2;
+      increments[2] = q;
+      increments[3] = ((1ll << 31) + q)/2;
+      increments[4] = 1ll << 31;
+
+      count = 0;
+    }
+
+    unsigned samples() const {return count;}
+
+    Quantile &operator+=(T sample) {
+      float x = sample;
+
+      if (count < 5) {
+        // insertion sort the first few into the markers
+        int i = count++;
+        for (; i > 0 && heights[i-1] > x; --i) heights[i] = heights[i-1];
+        heights[i] = x;
+        return *this;
+      }
+
+      count += 1;
+
+      int k; // the cell x falls into
+      if (x < heights[0]) {
+        heights[0] = x;
+        k = 0;
+      } else if (x >= heights[4]) {
+        heights[4] = x;
+        k = 3;
+      } else {
+        for (k=0; x >= heights[k+1]; ++k) {}
+      }
+
+      for (int i=k+1; i < 5; ++i) positions[i] += 1;
+
+      const int64_t ONE = 1ll << 31;
+      for (int i=1; i < 4; ++i) {
+        int64_t d = ONE + (int64_t) (count - 1)*increments[i] - (int64_t) positions[i]*ONE;
+
+        if ((d >= ONE && positions[i+1] - positions[i] > 1) ||
+            (d <= -ONE && positions[i-1] - positions[i] < -1)) {
+          int step = d > 0 ? 1 : -1;
+          float h = parabolic(i, step);
+
+          if (heights[i-1] < h && h < heights[i+1]) {
+            heights[i] = h;
+          } else {
+            heights[i] = linear(i, step);
+          }
+
+          positions[i] += step;
+        }
+      }
+
+      return *this;
+    }
+
+    // integer types are rounded to nearest
+    T value() const {
+      if (count >= 5) return to_sample(heights[2]);
+      if (count == 0) return 0;
+
+      // nearest rank among the samples so far
+      int rank = (int) ceil(quantile*count) - 1;
+      return to_sample(heights[rank < 0 ? 0 : rank]);
+    }
+
+    // zero until there are samples, like value()
+    T min() const {return count ? to_sample(heights[0]) : 0;}
+    T max() const {return count ? to_sample(heights[count >= 5 ? 4 : count - 1]) : 0;}
+  };
+
+  /**
+   * LogHistogram counts unsigned values, e.g., latencies in microseconds,
+   * in log-linear buckets like an HdrHistogram. Every value is kept to
+   * within Digits significant decimal digits: values below 2^S are exact
+   * and above that each power of two is split into 2^(S-1) equal buckets,
+   * where S is the fewest bits that hold 2*10^Digits. Recording a value is
+   * a CLZ and a few shifts. Values of MaxBits bits or more are counted in
+   * the top bucket.
+   *
+   * Two histograms of the same type can be merged with +=, so a snapshot
+   * (a plain copy, taken with interrupts masked if an ISR records into the
+   * original) can be accumulated elsewhere and the original reset.
+   *
+   * Memory is 4*(MaxBits - S + 2)*2^(S-1) bytes, e.g., 1.3K for one digit
+   * up to 2^24 (16 s in microseconds), and 9K for two digits.
+   */
+  template<unsigned Digits, unsigned MaxBits = 32>
+    class LogHistogram {
+    static constexpr uint32_t pow10(unsigned n) {return n == 0 ? 1 : 10*pow10(n - 1);}
+    static constexpr unsigned bits_for(uint32_t n, unsigned b = 0) {return (1ull << b) >= n ? b : bits_for(n, b + 1);}
+
+  public:
+    enum : unsigned {
+      SUB_BUCKET_BITS = bits_for(2*pow10(Digits)),
+      SUB_BUCKET_HALF = 1u << (SUB_BUCKET_BITS - 1),
+      BUCKETS = (MaxBits - SUB_BUCKET_BITS + 2) * SUB_BUCKET_HALF,
+      HIGHEST = (uint32_t) ((1ull << MaxBits) - 1)
+    };
+
+    static_assert(Digits >= 1 && Digits <= 4, "between 1 and 4 significant digits");
+    static_assert(MaxBits > SUB_BUCKET_BITS && MaxBits <= 32, "MaxBits out of range");
+
+    uint32_t buckets[BUCKETS];
+    uint32_t count, min, max;
+
+    LogHistogram() {reset();}
+
+    void reset() {
+      for (unsigned i=0; i < BUCKETS; ++i) buckets[i] = 0;
+      count = 0;
+      min = std::numeric_limits<uint32_t>::max();
+      max = 0;
+    }
+
+    static unsigned index_of(uint32_t value) {
+      if (value > HIGHEST) value = HIGHEST;
+
+      // the power of two above the value, but at least 2^SUB_BUCKET_BITS
+      unsigned magnitude = 32 - __builtin_clz(value | ((1u << SUB_BUCKET_BITS) - 1)) - SUB_BUCKET_BITS;
+      return (magnitude << (SUB_BUCKET_BITS - 1)) + (value >> magnitude);
+    }
+
+    // the smallest and largest values counted in bucket i
+    static uint32_t lowest_in(unsigned i) {
+      if (i < 2*SUB_BUCKET_HALF) return i;
+
+      unsigned magnitude = (i >> (SUB_BUCKET_BITS - 1)) - 1;
+      return ((i & (SUB_BUCKET_HALF - 1)) + SUB_BUCKET_HALF) << magnitude;
+    }
+
+    static uint32_t highest_in(unsigned i) {
+      if (i < 2*SUB_BUCKET_HALF) return i;
+
+      unsigned magnitude = (i >> (SUB_BUCKET_BITS - 1)) - 1;
+      return lowest_in(i) + ((1u << magnitude) - 1);
+    }
+
+    LogHistogram &operator+=(uint32_t value) {
+      buckets[index_of(value)] += 1;
+      count += 1;
+      if (value < min) min = value;
+      if (value > max) max = value;
+
+      return *this;
+    }
+
+    LogHistogram &operator+=(const LogHistogram &other) {
+      for (unsigned i=0; i < BUCKETS; ++i) buckets[i] += other.buckets[i];
+      count += other.count;
+      if (other.min < min) min = other.min;
+      if (other.max > max) max = other.max;
+
+      return *this;
+    }
+
+    /**
+     * The value that percent of the samples are less than or equal to, to
+     * within the histogram's precision, e.g., percentile(99) for p99. The
+     * answer is the top of the bucket holding that sample, so it never
+     * understates, and is clamped to the largest value recorded.
+     */
+    uint32_t percentile(float percent) const {
+      if (count == 0) return 0;
+      if (percent >= 100) return max;
+
+      uint64_t rank = (uint64_t) ceil((double) percent * count / 100.0);
+      if (rank == 0) rank = 1;
+
+      uint64_t seen = 0;
+      for (unsigned i=0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) return highest_in(i) < max ? highest_in(i) : max;
+      }
+
+      return max;
+    }
+
+    // approximate, using the middle of each bucket
+    uint32_t mean() const {
+      if (count == 0) return 0;
+
+      uint64_t sum = 0;
+      for (unsigned i=0; i < BUCKETS; ++i) {
+        if (buckets[i] != 0) sum += (uint64_t) buckets[i] * ((lowest_in(i) + (uint64_t) highest_in(i)) / 2);
+      }
+
+      return sum / count;
+    }
+  };
 };
@@ -0,0 +1,145 @@
+// -*- Mode:C++ -*-
+
+#pragma once
+
+#include "akt/assert.h"
+
+#include <cstddef>
+#include <new>
+#include <stdint.h>
+
+namespace akt {
+  /**
+   * Arena is a bump allocator for short-lived scratch memory, e.g., while a
+   * request is being handled. Allocation just advances an offset into a
+   * caller supplied block of storage, and everything allocated after a
+   * mark() is freed at once by rewind(). Arena::Scope does the marking and
+   * rewinding automatically, so scopes can be nested:
+   *
+   *   static uint8_t scratch[512];
+   *   Arena arena(scratch, sizeof(scratch));
+   *
+   *   void handle(Request &r) {
+   *     Arena::Scope scope(arena);
+   *     char *name = arena.allocate<char>(r.name_length + 1);
+   *     ...
+   *   } // name is gone
+   *
+   * Destructors are never run, so only objects that don't need them should
+   * live in an arena. Allocation returns 0 when the arena is exhausted. An
+   * arena isn't thread safe.
+   */
+  class Arena {
+    uint8_t *storage;
+    size_t capacity, top, peak;
+
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+  public:
+    enum {DEFAULT_ALIGNMENT = __BIGGEST_ALIGNMENT__};
+
+    class Scope {
+      Arena &arena;
+      const size_t saved;
+
+      Scope(const Scope &);
+      Scope &operator=(const Scope &);
+
+    public:
+      Scope(Arena &a) : arena(a), saved(a.mark()) {}
+      ~Scope() {arena.rewind(saved);}
+    };
+
+    Arena(void *s, size_t len) :
+      storage((uint8_t *) s),
+      capacity(len),
+      top(0),
+      peak(0)
+    {}
+
+    size_t size() const {return capacity;}
+    size_t used() const {return top;}
+    size_t available() const {return capacity - top;}
+    size_t high_water() const {return peak;} /// most ever used at once
+
+    // align must be a power of two
+    void *allocate(size_t len, size_t align = DEFAULT_ALIGNMENT) {
+      uintptr_t address = (uintptr_t) (storage + top);
+      size_t padding = (align - (address & (align - 1))) & (align - 1);
+
+      if (len > capacity - top || padding > capacity - top - len) return 0;
+
+      void *p = storage + top + padding;
+      top += padding + len;
+      if (top > peak) peak = top;
+
+      return p;
+    }
+
+    // uninitialized storage for count elements of T
+    template<class T> T *allocate(size_t count = 1) {
+      if (count > capacity / sizeof(T)) return 0;
+      return (T *) allocate(count * sizeof(T), alignof(T));
+    }
+
+    // gives the space back only if p was the last allocation
+    void deallocate(void *p, size_t len) {
+      if ((uint8_t *) p + len == storage + top) top = (uint8_t *) p - storage;
+    }
+
+    size_t mark() const {return top;}
+
+    void rewind(size_t m) {
+      assert(m <= top); // scopes must be rewound innermost first
+      top = m;
+    }
+
+    void reset() {top = 0;}
+  };
+
+  /**
+   * Standard allocator adaptor, so containers can keep their elements in
+   * an Arena, e.g.,
+   *
+   *   std::vector<int, ArenaAllocator<int> > v(ArenaAllocator<int>(arena));
+   *
+   * Running out of arena space is treated like any other failed assertion.
+   */
+  template<class T> class ArenaAllocator {
+    template<class U> friend class ArenaAllocator;
+    Arena *arena;
+
+  public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<class U> struct rebind {typedef ArenaAllocator<U> other;};
+
+    ArenaAllocator(Arena &a) : arena(&a) {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n, const void *hint = 0) {
+      T *p = arena->allocate<T>(n);
+      assert(p != 0);
+      return p;
+    }
+
+    void deallocate(T *p, size_t n) {
+      arena->deallocate(p, n * sizeof(T));
+    }
+
+    size_t max_size() const {return arena->size() / sizeof(T);}
+
+    void construct(T *p, const T &value) {new ((void *) p) T(value);}
+    void destroy(T *p) {p->~T();}
+
+    template<class U> bool operator==(const ArenaAllocator<U> &other) const {return arena == other.arena;}
+    template<class U> bool operator!=(const ArenaAllocator<U> &other) const {return arena != other.arena;}
+  };
+};
@@ -0,0 +1,89 @@
+// -*- Mode:C++ -*-
+
+#pragma once
+
+#include "akt/assert.h"
+
+#include <stdint.h>
+
+namespace akt {
+  /**
+   * BitStackBase is a stack of small unsigned values, each packed into Bits
+   * bits of an array of words supplied by a subclass (see BitStack). It's
+   * meant for nesting state, e.g., in the JSON reader and writer, where a
+   * level needs a couple of bits rather than a whole int. The interface
+   * follows Stack, but values are returned by value since they can't be
+   * referenced in place.
+   */
+  template<unsigned Bits> class BitStackBase {
+    static_assert(Bits > 0 && 32 % Bits == 0, "Bits must divide 32");
+
+    enum : uint32_t {
+      PER_WORD = 32 / Bits,
+      MASK = (uint32_t) ((1ull << Bits) - 1)
+    };
+
+    uint32_t *words;
+    unsigned capacity;
+    unsigned tos; // top of stack
+
+    BitStackBase(const BitStackBase &);
+    BitStackBase &operator=(const BitStackBase &);
+
+    unsigned get(unsigned i) const {
+      return (words[i / PER_WORD] >> ((i % PER_WORD) * Bits)) & MASK;
+    }
+
+    void set(unsigned i, unsigned value) {
+      unsigned shift = (i % PER_WORD) * Bits;
+      uint32_t &w = words[i / PER_WORD];
+
+      w = (w & ~(MASK << shift)) | ((value & MASK) << shift);
+    }
+
+  protected:
+    BitStackBase(uint32_t *w, unsigned depth) : words(w), capacity(depth), tos(0) { }
+
+  public:
+    enum : unsigned {MAX_VALUE = MASK};
+
+    void               reset()       { tos = 0; }
+    bool               empty() const { return tos == 0; }
+    bool                full() const { return tos == capacity; }
+    unsigned space_remaining() const { return capacity - tos; }
+    unsigned           depth() const { return tos; }
+
+    unsigned top() const {
+      assert(!empty());
+      return get(tos - 1);
+    }
+
+    void replace_top(unsigned value) {
+      assert(!empty() && value <= MAX_VALUE);
+      set(tos - 1, value);
+    }
+
+    bool push(unsigned value) {
+      assert(value <= MAX_VALUE);
+      if (full()) return false;
+
+      set(tos++, value);
+      return true;
+    }
+
+    bool pop(unsigned &value) {
+      if (empty()) return false;
+
+      value = get(--tos);
+      return true;
+    }
+  };
+
+  template<unsigned Bits, unsigned Depth>
+  class BitStack : public BitStackBase<Bits> {
+    uint32_t storage[(Bits * Depth + 31) / 32];
+
+  public:
+    BitStack() : BitStackBase<Bits>(storage, Depth) { }
+  };
+}
@@ -1,5 +1,6 @@
 #include "akt/assert.h"
 #include "akt/bluetooth/att.h"
+#include "akt/bluetooth/pdu.h"
 
 #include <cstring>
 #include <algorithm>
@@ -97,7 +98,7 @@ namespace akt::bluetooth {
   }
 
   bool ATT_Channel::read_handles() {
-    *req >> h1 >> h2;
+    req->reserve(2*sizeof(uint16_t)) >> h1 >> h2;
     if (h1 > h2 || h1 == 0) {
       error(ATT::INVALID_HANDLE);
       return false;
@@ -108,7 +109,12 @@ namespace akt::bluetooth {
 
   void ATT_Channel::error(uint8_t err) {
     rsp = req;
-    rsp->l2cap() << (uint8_t) ATT::OPCODE_ERROR << req_opcode << h1 << err;  
+    ATT::ErrorResponse &e = pdu<ATT::ErrorResponse>(rsp->l2cap());
+
+    e.code = ATT::OPCODE_ERROR;
+    e.request_opcode = req_opcode;
+    e.handle = h1;
+    e.error_code = err;
   }
 
   bool ATT_Channel::is_grouping(const UUID &type) {
@@ -124,7 +130,7 @@ namespace akt::bluetooth {
     uint16_t info_length = short_info;
 
   restart:
-    rsp->l2cap(att_mtu);
+    rsp->l2cap(rsp->l2cap_limit(att_mtu));
     *rsp << rsp_opcode;
     uint8_t *format = (uint8_t *) rsp;
     *rsp << (uint8_t) 0; // format placeholder
@@ -139,11 +145,9 @@ namespace akt::bluetooth {
           goto restart;
         }
 
-        *rsp << attr->handle;
-        *rsp << (uint16_t) attr->type;
+        rsp->reserve(short_info) << attr->handle << (uint16_t) attr->type;
       } else {
-        *rsp << attr->handle;
-        rsp->write(attr->type.data, sizeof(attr->type.data));
+        (rsp->reserve(long_info) << attr->handle).write(attr->type.data, sizeof(attr->type.data));
       }
     }
 
@@ -157,7 +161,7 @@ namespace akt::bluetooth {
     }
 
     rsp = req; // re-use request packet
-    rsp->l2cap(att_mtu);
+    rsp->l2cap(rsp->l2cap_limit(att_mtu));
 
     *rsp << rsp_opcode;
     uint8_t &attribute_data_length = *(uint8_t *) *rsp;
@@ -181,9 +185,10 @@ namespace akt::bluetooth {
         break;
       }
 
-      *rsp << attr->handle << attr->group_end();
-      data_length = std::min(attr_length, rsp->remaining());
-      rsp->write((const uint8_t *) attr->_data, data_length);
+      data_length = std::min(attr_length, (uint16_t) (rsp->remaining() - 2*sizeof(uint16_t)));
+      ByteCursor entry = rsp->reserve(2*sizeof(uint16_t) + data_length);
+      entry << attr->handle << attr->group_end();
+      entry.write(attr->_data, data_length);
     }
   
     if (attr_length == 0) {
@@ -204,7 +209,7 @@ namespace akt::bluetooth {
     // can't re-use the request packet because we need the data at the end
     rsp = controller.acl_packets->allocate();
     assert(rsp != 0);
-    rsp->l2cap(req, att_mtu); // re-use existing L2CAP framing from request
+    rsp->l2cap(req, rsp->l2cap_limit(att_mtu)); // re-use existing L2CAP framing from request
 
     *rsp << rsp_opcode;
     uint16_t found_attribute_handle = 0, group_end_handle;
@@ -227,7 +232,7 @@ namespace akt::bluetooth {
         if (next_h < h1 || next_h > h2) group_end_handle = 0xffff;
       }
 
-      *rsp << found_attribute_handle << group_end_handle;
+      rsp->reserve(2*sizeof(uint16_t)) << found_attribute_handle << group_end_handle;
       h = next_h;
     }
 
@@ -239,7 +244,7 @@ namespace akt::bluetooth {
 
   void ATT_Channel::read_by_type() {
     rsp = req; // re-use request packet
-    rsp->l2cap(att_mtu);
+    rsp->l2cap(rsp->l2cap_limit(att_mtu));
 
     *rsp << (uint8_t) rsp_opcode;
     uint8_t &data_length = *(uint8_t *) *rsp;
@@ -263,8 +268,7 @@ namespace akt::bluetooth {
         break;
       }
 
-      *rsp << h;
-      rsp->write((const uint8_t *) attr->_data, data_length - sizeof(uint16_t));
+      (rsp->reserve(data_length) << h).write(attr->_data, data_length - sizeof(uint16_t));
       h += 1;
     } while (rsp->remaining() >= data_length);
   
@@ -286,7 +290,7 @@ namespace akt::bluetooth {
     case ATT::OPCODE_ERROR : {
       uint8_t error_code;
 
-      *p >> req_opcode >> h1 >> error_code;
+      p->reserve(1+2+1) >> req_opcode >> h1 >> error_code;
       debug("ATT error for opcode: 0x%02x, handle: 0x%04x, error: 0x%02x\n",
             req_opcode, h1, error_code);
       break;
@@ -296,7 +300,11 @@ namespace akt::bluetooth {
       rsp_opcode = ATT::OPCODE_EXCHANGE_MTU_RESPONSE;
       *req >> client_rx_mtu;
       rsp = req;
-      rsp->l2cap() << rsp_opcode << att_mtu;
+      {
+        ATT::ExchangeMTUResponse &r = pdu<ATT::ExchangeMTUResponse>(rsp->l2cap());
+        r.code = rsp_opcode;
+        r.server_rx_mtu = att_mtu;
+      }
       debug("ATT: client MTU = %d\n", client_rx_mtu);
       break;
 
@@ -341,8 +349,8 @@ namespace akt::bluetooth {
         error(ATT::INVALID_HANDLE);
       } else {
         rsp = req;
-        rsp->l2cap(att_mtu) << rsp_opcode;
-        rsp->write((uint8_t *) attr->_data, std::min(rsp->remaining(), attr->length));
+        rsp->l2cap(rsp->l2cap_limit(att_mtu)) << rsp_opcode;
+        rsp->write_or_append(value, attr->_data, std::min<uint16_t>(att_mtu - 1, attr->length), COPY_LIMIT);
       }
       break;
     
@@ -354,14 +362,15 @@ namespace akt::bluetooth {
         error(ATT::INVALID_HANDLE);
       } else {
         rsp = req;
-        rsp->l2cap(att_mtu) << rsp_opcode;
+        rsp->l2cap(rsp->l2cap_limit(att_mtu)) << rsp_opcode;
     
         if (attr->length < att_mtu) {
           error(ATT::ATTRIBUTE_NOT_LONG);
         } else if (offset >= attr->length) {
           error(ATT::INVALID_OFFSET);
         } else {
-          rsp->write(((uint8_t *) attr->_data) + offset, std::min(rsp->remaining(), attr->length));
+          rsp->write_or_append(value, ((const uint8_t *) attr->_data) + offset,
+                               std::min<uint16_t>(att_mtu - 1, attr->length - offset), COPY_LIMIT);
         }
       }
       break;
@@ -9,6 +9,12 @@
 #include <stdint.h>
 
 namespace akt::bluetooth {
+  /**
+   * Read responses send values longer than ATT_Channel::COPY_LIMIT
+   * straight from _data as a PacketSegment, so a long attribute mustn't be
+   * changed, e.g., from another thread or an ISR, until the response has
+   * been sent (PacketDelegate::sent_hci), or a torn value goes out.
+   */
   class AttributeBase : public Ring<AttributeBase> {
     enum {MAX_ATTRIBUTES = 20};
     static uint16_t next_handle;
@@ -54,6 +60,10 @@ namespace akt::bluetooth {
   };
 
   class ATT_Channel : public Channel {
+    // Read responses copy values up to this long, since that costs no more
+    // than chaining them and lets them change while the packet is sent.
+    enum {COPY_LIMIT = 32};
+
     void error(uint8_t err);
     bool read_handles();
     bool read_type();
@@ -72,6 +82,7 @@ namespace akt::bluetooth {
     UUID type;
     Packet *req;
     Packet *rsp;
+    PacketSegment value; // read responses send the attribute in place
 
   public:
     ATT_Channel(HostController &hc);
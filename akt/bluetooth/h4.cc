@@ -12,14 +12,31 @@ namespace akt {
     {
     }
 
+    // The DMA is done with the last buffer, so a packet's segments can be
+    // started here, back to back. The STM32 DMA has no descriptor lists, but
+    // starting the next transfer from this callback keeps the USART fed
+    // without a gap, and before the transmission complete interrupt.
+    void H4::H4UART::txend1() {
+      PacketSegment *s = h4.tx_segment;
+
+      if (s != 0) {
+        h4.tx_segment = s->next;
+        sendI((void *) s->data, s->length);
+      }
+    }
+
     void H4::H4UART::txend2() {
-      if (h4.tx != 0) {                    // must have a packet
-        // what about taking tx off the send queue?
+      if (h4.tx_segment != 0) {
+        // between segments, the packet isn't finished
+      } else if (h4.tx != 0) {             // must have a packet
         (h4.delegate ? h4.delegate : &h4)->sent_hci(*h4.tx);
-        h4.tx = 0;                         // done transmitting that one
 
-        if (!h4.send_queue.empty()) { // more to send?
-          h4.tx = h4.send_queue.rbegin();
+        // more to send? If not, tx_busy is cleared, and a packet that's
+        // still being pushed will be started by its sender.
+        h4.tx = h4.send_queue.pop_or_release(h4.tx_busy);
+
+        if (h4.tx != 0) {
+          h4.tx_segment = h4.tx->segments;
           sendI((uint8_t *) *h4.tx, h4.tx->remaining());
         }
       } else {
@@ -32,7 +49,11 @@ namespace akt {
     }
 
     H4::H4(UARTDriver &u, uint32_t baud, uint32_t cr3_flags) :
-      uart(u, this, baud, cr3_flags)
+      uart(u, this, baud, cr3_flags),
+      tx_busy(false),
+      tx_segment(0),
+      command_packets("h4 command/event"),
+      acl_packets("h4 acl")
     {
       chEvtInit(&packets_received_event);
     }
@@ -73,10 +94,12 @@ namespace akt {
           chThdSleepMilliseconds(20);
           palClearPad(GPIOC, 3);
 
-          assert(!recv_queue.empty());
-          Packet *p = recv_queue.rbegin();
+          // several packets may have arrived for a single event
+          Packet *p;
 
-          (delegate ? delegate : this)->recv_hci(*p);
+          while ((p = recv_queue.pop()) != 0) {
+            (delegate ? delegate : this)->recv_hci(*p);
+          }
           continue;
         }
       }
@@ -87,12 +110,14 @@ namespace akt {
     void H4::reset() {
       uart.stop();
       tx = rx = 0;
+      tx_segment = 0;
       uart.set_baud(115200);
 
       command_packets.reset();
       acl_packets.reset();
-      send_queue.join(&send_queue);
-      recv_queue.join(&recv_queue);
+      send_queue.reset();
+      recv_queue.reset();
+      tx_busy = false;
 
       uart.start();
 
@@ -102,13 +127,15 @@ namespace akt {
     }
 
     void H4::send(Packet &p) {
-      chSysLock();
-      p.join(&send_queue);
-      if (tx == 0) {
-        tx = &p;
-        uart.sendI((uint8_t *) *tx, tx->remaining());
+      // Start the UART unless a transfer is already running, in which case
+      // txend2() will get to this packet.
+      Packet *next = send_queue.push_and_claim(&p, tx_busy);
+
+      if (next != 0) {
+        tx = next;
+        tx_segment = tx->segments;
+        uart.send((uint8_t *) *tx, tx->remaining());
       }
-      chSysUnlock();
     }
 
     void H4::set_baud(uint32_t baud) {
@@ -136,10 +163,9 @@ namespace akt {
         break;
 
       case HCI::ACL_PACKET :
-        rx = acl_packets.allocate();
-        assert(rx != 0);
-
-        rx->limit(1+4);
+        // the packet is allocated once the header says how big it is
+        rx = &acl_header;
+        rx->reset();
         *rx << *indicator;
         rx_state = &rx_acl_header_state;
         break;
@@ -177,8 +203,15 @@ namespace akt {
     }
 
     void H4::rx_acl_header_state() {
-      *rx += 4; // just read in acl header
-      uint16_t length = ((*rx)[-1] << 8) + (*rx)[-2];
+      acl_header += 4; // just read in acl header
+      uint16_t length = (acl_header[-1] << 8) + acl_header[-2];
+
+      rx = acl_packets.allocate(1+4+length);
+      assert(rx != 0);
+
+      acl_header.flip();
+      rx->write((uint8_t *) acl_header, acl_header.remaining());
+
       chSysLockFromIsr();
       rx->limit(1+4+length);
       rx_state = &rx_queue_received_packet_state;
@@ -189,9 +222,9 @@ namespace akt {
     void H4::rx_queue_received_packet_state() {
       rx->skip(rx->remaining());
       rx->flip();
+      recv_queue.push(rx);
 
       chSysLockFromIsr();
-      rx->join(&recv_queue);
       chEvtSignalI((Thread *) &rx_thread, RX_PACKET_EVENT);
       begin_new_packet();
       chSysUnlockFromIsr();
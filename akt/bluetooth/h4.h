@@ -4,10 +4,13 @@
 
 #include "akt/assert.h"
 #include "akt/uart.h"
+#include "akt/mpscqueue.h"
 #include "akt/bluetooth/packet.h"
 
 #include "ch.h"
 
+#include <atomic>
+
 namespace akt {
   namespace bluetooth {
 
@@ -28,6 +31,7 @@ namespace akt {
 
       class H4UART : public UART {
         H4 &h4;
+        virtual void txend1();
         virtual void txend2();
         virtual void rxend();
 
@@ -35,11 +39,17 @@ namespace akt {
         H4UART(UARTDriver &u, H4 *h4, uint32_t baud = 115200, uartflags_t cr3_flags = 0);
       } uart;
 
-      Ring<Packet> send_queue, recv_queue;
+      // Both queues are lock-free, so packets can be queued from threads and
+      // from the UART ISR without chSysLock. The send queue is drained by
+      // whoever sets tx_busy, the receive queue by the rx thread.
+      MPSCQueue<Packet> send_queue, recv_queue;
+      std::atomic<bool> tx_busy;
       PacketDelegate *delegate;
       Packet *tx, *rx;
+      PacketSegment *tx_segment; // next segment of tx to go out
       void (*rx_state)(H4 *self);
       SizedPacket<1> indicator;
+      SizedPacket<1+4> acl_header; // read before the packet size is known
       WORKING_AREA(rx_thread, 1024);
       EventSource packets_received_event;
 
@@ -56,9 +66,18 @@ namespace akt {
       virtual void sent_hci(Packet &p) override;
 
     public:
-      PacketPool<259, 4> command_packets;
-      PacketPool<1000, 4> acl_packets;
-      
+      // LE controllers mostly send 27 or 251 byte ACL payloads, which fit
+      // exactly into the 32 and 256 byte classes with their H4 framing
+      typedef SlabPacketPool<SizeClass<32, 8>,
+                             SizeClass<64, 4>,
+                             SizeClass<128, 4>,
+                             SizeClass<256, 4>,
+                             SizeClass<1024, 1> > ACLPacketPool;
+
+      // allocated from the UART ISR and released by threads
+      LockFreePacketPool<259, 4> command_packets;
+      ACLPacketPool acl_packets;
+
       H4(UARTDriver &u, uint32_t baud, uartflags_t cr3_flags);
 
       void start();
@@ -78,8 +97,9 @@ namespace akt {
         return command_packets.allocate();
       }
 
-      Packet *alloc_acl_packet() {
-        return acl_packets.allocate();
+      // length includes the H4 framing, i.e., Packet::ACL_HEADER_SIZE
+      Packet *alloc_acl_packet(unsigned int length) {
+        return acl_packets.allocate(length);
       }
     };
   };
@@ -5,12 +5,14 @@
 #include "board.h"
 
 #include "akt/bluetooth/hci.h"
+#include "akt/bluetooth/pdu.h"
 #include "debug.h"
 
 namespace akt {
   namespace bluetooth {
     HostController::HostController(H4 &h4) :
       h4(h4),
+      connections("hci connections"),
       script(0)
     {
       h4.set_delegate(*this);
@@ -73,15 +75,14 @@ namespace akt {
     void HostController::recv_event(uint8_t event, Packet &p) {
       switch (event) {
       case EVENT_DISCONNECTION_COMPLETE : {
-        uint16_t handle;
-        uint8_t status, reason;
-
-        p >> status >> handle >> reason;
-        handle &= 0x0fff;
+        const DisconnectionComplete &e = pdu<DisconnectionComplete>(p);
+        uint16_t handle = e.connection_handle & 0x0fff;
+        uint8_t status = e.status, reason = e.reason;
 
         debug("disconnected 0x%04x (with status: 0x%02x) because 0x%02x\n", handle, status, reason);
         debug("re-enabling LE advertising\n");
-        p.hci(OPCODE_LE_SET_ADVERTISE_ENABLE) << (uint8_t) 0x01;
+        p.hci(OPCODE_LE_SET_ADVERTISE_ENABLE);
+        pdu<LESetAdvertiseEnable>(p).advertising_enable = 0x01;
         h4.send(p);
         return; // avoid deallocation of p
       }
@@ -121,19 +122,14 @@ namespace akt {
     void HostController::recv_le_event(uint8_t subevent, Packet &p) {
       switch(subevent) {
       case LE_EVENT_CONNECTION_COMPLETE : {
+        const LEConnectionComplete &e = pdu<LEConnectionComplete>(p);
         BD_ADDR peer_address;
-        uint8_t status, role, peer_address_type, master_clock_accuracy;
-        uint16_t connection_handle, conn_interval, conn_latency, supervision_timeout;
 
-        p >> status >> connection_handle >> role;
-        p >> peer_address_type;
-        p.write(peer_address.data, sizeof(peer_address.data));
-        p >> conn_interval >> conn_latency;
-        p >> supervision_timeout >> master_clock_accuracy;
+        memcpy(peer_address.data, e.peer_address, sizeof(peer_address.data));
 
         const char *type;
 
-        switch (peer_address_type) {
+        switch (e.peer_address_type) {
         case 0 :
           type = "public";
           break;
@@ -149,7 +145,7 @@ namespace akt {
 
         const char *role_name;
     
-        switch (role) {
+        switch (e.role) {
         case 0 :
           role_name = "master";
           break;
@@ -165,11 +161,12 @@ namespace akt {
 
         char buf[BD_ADDR::PRETTY_SIZE];
         const char *addr = peer_address.pretty_print(buf);
-        debug("connection to %s completed with status %d\n", addr, status);
-        debug("  handle = 0x%04x, addr_type = %s\n", connection_handle, type);
+        debug("connection to %s completed with status %d\n", addr, (uint8_t) e.status);
+        debug("  handle = 0x%04x, addr_type = %s\n", (uint16_t) e.connection_handle, type);
         debug("  role = %s, interval = %d, latency = %d, timeout = %d\n",
-              role_name, conn_interval, conn_latency, supervision_timeout);
-        debug("  clock_accuracy = %d\n", master_clock_accuracy);
+              role_name, (uint16_t) e.conn_interval, (uint16_t) e.conn_latency,
+              (uint16_t) e.supervision_timeout);
+        debug("  clock_accuracy = %d\n", (uint8_t) e.master_clock_accuracy);
         break;
       }
       case LE_EVENT_ADVERTISING_REPORT :
@@ -187,16 +184,14 @@ namespace akt {
 
       switch (opcode) {
       case OPCODE_READ_LOCAL_VERSION_INFORMATION : {
-        uint8_t hci_version, lmp_version;
-        uint16_t hci_revision, manufacturer_name, lmp_subversion;
+        const LocalVersionInformation &r = pdu<LocalVersionInformation>(p);
 
-        p >> hci_version >> hci_revision >> lmp_version >> manufacturer_name >> lmp_subversion;
-        assert(hci_version == SPECIFICATION_4_0);
+        assert(r.hci_version == SPECIFICATION_4_0);
         break;
       }
 
       case OPCODE_READ_BD_ADDR : {
-        p.read(bd_addr.data, sizeof(bd_addr.data));
+        memcpy(bd_addr.data, pdu<ReadBDAddr>(p).bd_addr, sizeof(bd_addr.data));
 
         debug("bd_addr = ");
         for (int i=5; i >= 0; --i) debug("%02x:", bd_addr.data[i]);
@@ -205,44 +200,36 @@ namespace akt {
       }
 
       case OPCODE_READ_BUFFER_SIZE_COMMAND : {
-        uint16_t acl_data_length, num_acl_packets, num_synchronous_packets;
-        uint8_t synchronous_data_length;
-
-        p >> acl_data_length >> synchronous_data_length;
-        p >> num_acl_packets >> num_synchronous_packets;
+        const BufferSize &r = pdu<BufferSize>(p);
 
         debug("acl: %d @ %d, synchronous: %d @ %d\n",
-              num_acl_packets, acl_data_length,
-              num_synchronous_packets, synchronous_data_length);
+              (uint16_t) r.total_num_acl_data_packets, (uint16_t) r.acl_data_packet_length,
+              (uint16_t) r.total_num_synchronous_data_packets,
+              (uint8_t) r.synchronous_data_packet_length);
         break;
       }
 
       case OPCODE_READ_PAGE_TIMEOUT : {
-        uint16_t timeout;
-
-        p >> timeout;
-        uint32_t usec = timeout*625;
+        uint32_t usec = pdu<PageTimeout>(p).page_timeout*625;
         debug("page timeout = %d.%d msec\n", usec/1000, usec%1000);
         break;
       }
 
       case OPCODE_LE_READ_BUFFER_SIZE : {
         debug("buffer size read\n");
-        uint16_t le_data_packet_length;
-        uint8_t num_le_packets;
+        const LEBufferSize &r = pdu<LEBufferSize>(p);
 
-        p >> le_data_packet_length >> num_le_packets;
-        debug("le_data_packet_length = %d, num_packets = %d\n", le_data_packet_length, num_le_packets);
+        debug("le_data_packet_length = %d, num_packets = %d\n",
+              (uint16_t) r.le_data_packet_length, (uint8_t) r.total_num_le_data_packets);
         break;
       }
 
       case OPCODE_LE_READ_SUPPORTED_STATES : {
         debug("supported states read\n");
 
-        uint8_t states[8];
-        p.read(states, sizeof(states));
+        const LESupportedStates &r = pdu<LESupportedStates>(p);
         debug("states = 0x");
-        for (int i=0; i < 8; ++i) debug("%02x", states[i]);
+        for (int i=0; i < 8; ++i) debug("%02x", r.le_states[i]);
         debug("\n");
         break;
       }
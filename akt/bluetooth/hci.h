@@ -21,7 +21,7 @@ namespace akt {
       friend class Script;
 
       H4 &h4;
-      Pool<Connection,4> connections;
+      BitmapPool<Connection,4> connections;
       uint8_t command_packet_budget;
       Script *script;
 
@@ -16,25 +16,88 @@ namespace akt {
   namespace bluetooth {
     using namespace HCI;
 
+    /**
+     * Bytes that follow a packet onto the wire without being copied into
+     * it, e.g., an attribute value sent straight from where it's stored.
+     * Segments are owned by the caller, and both they and the bytes they
+     * point at must stay put and unchanged until the packet has been sent
+     * (see PacketDelegate::sent_hci), since the UART reads them directly.
+     */
+    struct PacketSegment {
+      const uint8_t *data;
+      uint16_t length;
+      PacketSegment *next;
+
+      PacketSegment() : data(0), length(0), next(0) {}
+      PacketSegment(const void *d, uint16_t len) : data((const uint8_t *) d), length(len), next(0) {}
+
+      PacketSegment &assign(const void *d, uint16_t len) {
+        data = (const uint8_t *) d;
+        length = len;
+        next = 0;
+        return *this;
+      }
+    };
+
     class Packet : public Ring<Packet>, public FlipBuffer<uint8_t> {
     public:
       const char *title;
-      Ring<Packet> *free_packets;
+      Deallocator<Packet> *owner; // the pool this packet came from
+      PacketSegment *segments;    // sent after the packet's own bytes
 
     Packet() :
       title(0),
-        free_packets(0)
+        owner(0),
+        segments(0)
           {}
 
     Packet(uint8_t *buf, uint16_t len) :
       FlipBuffer(buf, len),
       title(0),
-      free_packets(0)
+      owner(0),
+      segments(0)
     {}
 
+      // also forgets any segments, which the pools rely on
+      void reset(unsigned l=0) {
+        FlipBuffer<uint8_t>::reset(l);
+        segments = 0;
+      }
+
+      // adds s to the end of the chain
+      Packet &append(PacketSegment &s) {
+        PacketSegment **tail = &segments;
+
+        while (*tail != 0) tail = &(*tail)->next;
+        s.next = 0;
+        *tail = &s;
+        return *this;
+      }
+
+      /*
+       * Copies data into the packet if it's no longer than copy_limit and
+       * fits, and otherwise chains it as s, in which case it must stay put
+       * and unchanged until the packet has been sent.
+       */
+      Packet &write_or_append(PacketSegment &s, const void *data, uint16_t len, uint16_t copy_limit) {
+        if (len <= copy_limit && len <= remaining()) {
+          write((const uint8_t *) data, len);
+          return *this;
+        }
+
+        return append(s.assign(data, len));
+      }
+
+      unsigned segment_length() const {
+        unsigned length = 0;
+
+        for (const PacketSegment *s = segments; s != 0; s = s->next) length += s->length;
+        return length;
+      }
+
       void deallocate() {
-        assert(free_packets != 0);
-        join(free_packets);
+        assert(owner != 0);
+        owner->deallocate(this);
       }
 
       Packet &operator<<(uint8_t x) {
@@ -81,20 +144,28 @@ namespace akt {
 
       operator uint8_t *() {return storage + pos;}
 
+      // checks once for n bytes, see FlipBuffer::reserve() and ByteCursor
+      ByteCursor reserve(unsigned n) {
+        return ByteCursor(FlipBuffer<uint8_t>::reserve(n));
+      }
+
+      // The length fields cover the chained segments, which the transport
+      // sends after the packet's own bytes.
       void prepare_for_tx() {
+        unsigned chained = segment_length();
 
         if (pos != 0) flip();
 
         switch (storage[0]) {
         case COMMAND_PACKET :
           seek(3);
-          *this << (uint8_t) (lim - 4); // command length
+          *this << (uint8_t) (lim - 4 + chained); // command length
           break;
 
         case ACL_PACKET :
           seek(3);
-          *this << (uint16_t) (lim - 5); // acl length
-          *this << (uint16_t) (lim - 9); // l2cap length
+          *this << (uint16_t) (lim - 5 + chained); // acl length
+          *this << (uint16_t) (lim - 9 + chained); // l2cap length
           break;
         }
 
@@ -136,6 +207,12 @@ namespace akt {
         return acl(handle, 0x02, 0x00) << (uint16_t) 0 << cid;
       }
 
+      // the limit for an L2CAP payload of up to mtu bytes, e.g., ATT_MTU
+      uint16_t l2cap_limit(uint16_t mtu) const {
+        unsigned l = L2CAP_HEADER_SIZE + mtu;
+        return (l < capacity()) ? l : capacity();
+      }
+
       /*
        * The following two methods re-use existing L2CAP framing information.
        * The packet is reset, but the L2CAP framing is either preserved
@@ -162,6 +239,9 @@ namespace akt {
         void dump_hex_bytes(uint8_t *, size_t);
 
         dump_hex_bytes((uint8_t *) *this, remaining());
+        for (PacketSegment *s = segments; s != 0; s = s->next) {
+          dump_hex_bytes((uint8_t *) s->data, s->length);
+        }
         debug("\n");
       }
 #endif
@@ -175,13 +255,147 @@ namespace akt {
     };
 
     template<unsigned int packet_size, unsigned int packet_count>
-      class PacketPool : public Pool<SizedPacket<packet_size>, packet_count> {
+      class PacketPool : public Pool<SizedPacket<packet_size>, packet_count>,
+                         public Deallocator<Packet> {
+      typedef Pool<SizedPacket<packet_size>, packet_count> Base;
+
+    public:
+    PacketPool(const char *name = 0) : Base(name) {
+        for (unsigned int i=0; i < packet_count; ++i) {
+          this->pool[i].owner = this;
+        }
+      }
+
+      using Base::deallocate;
+
+      virtual void deallocate(Packet *p) override {
+        Base::deallocate((SizedPacket<packet_size> *) p);
+      }
+    };
+
+    /*
+     * Same as PacketPool, but allocate() and deallocate() are safe from any
+     * thread or ISR without locking (see LockFreePool).
+     */
+    template<unsigned int packet_size, unsigned int packet_count>
+      class LockFreePacketPool : public LockFreePool<SizedPacket<packet_size>, packet_count>,
+                                 public Deallocator<Packet> {
+      typedef LockFreePool<SizedPacket<packet_size>, packet_count> Base;
+
+    public:
+    LockFreePacketPool(const char *name = 0) : Base(name) {
+        for (unsigned int i=0; i < packet_count; ++i) {
+          this->pool[i].owner = this;
+        }
+      }
+
+      using Base::deallocate;
+
+      virtual void deallocate(Packet *p) override {
+        // a ring based pool would unlink the packet as a side effect
+        p->join(p);
+        Base::deallocate((SizedPacket<packet_size> *) p);
+      }
+    };
+
+    /*
+     * Same as PacketPool, but backed by a BitmapPool, so packets are handed
+     * out lowest address first and double frees are caught.
+     */
+    template<unsigned int packet_size, unsigned int packet_count>
+      class BitmapPacketPool : public BitmapPool<SizedPacket<packet_size>, packet_count>,
+                               public Deallocator<Packet> {
+      typedef BitmapPool<SizedPacket<packet_size>, packet_count> Base;
+
     public:
-    PacketPool() : Pool<SizedPacket<packet_size>, packet_count>() {
+    BitmapPacketPool(const char *name = 0) : Base(name) {
         for (unsigned int i=0; i < packet_count; ++i) {
-          this->pool[i].free_packets = (Ring<Packet> *) &this->available;
+          this->pool[i].owner = this;
         }
       }
+
+      using Base::deallocate;
+
+      virtual void deallocate(Packet *p) override {
+        p->join(p);
+        Base::deallocate((SizedPacket<packet_size> *) p);
+      }
+    };
+
+    /*
+     * One size class of a SlabPacketPool: packet_count packets that each
+     * hold up to packet_size bytes, including the H4 framing.
+     */
+    template<unsigned int packet_size, unsigned int packet_count>
+      struct SizeClass {};
+
+    /*
+     * SlabPacketPool keeps a LockFreePacketPool for each size class and
+     * hands out a packet from the smallest class that fits the requested
+     * length, so a 27 byte LE ACL payload doesn't tie up a 1000 byte buffer.
+     * When the best class is exhausted the next larger one is tried, and a
+     * failure is only counted, against the best class, when none of them
+     * has a packet. Size classes must be listed from smallest to largest,
+     * e.g.,
+     *
+     *   SlabPacketPool<SizeClass<32, 8>, SizeClass<256, 4>, SizeClass<1024, 1> >
+     *
+     * Packets find their way back to the right class through their owner,
+     * so they're released with Packet::deallocate() as usual.
+     */
+    template<class... Classes> class SlabPacketPool;
+
+    template<> class SlabPacketPool<> {
+    public:
+      enum {MAX_PACKET_SIZE = 0};
+
+      SlabPacketPool(const char *name = 0) {}
+      Packet *allocate(unsigned int length) {return 0;}
+      Packet *try_allocate(unsigned int length) {return 0;}
+      void reset() {}
+    };
+
+    template<unsigned int packet_size, unsigned int packet_count, class... Larger>
+      class SlabPacketPool<SizeClass<packet_size, packet_count>, Larger...> {
+      typedef SlabPacketPool<Larger...> Next;
+
+      static_assert(Next::MAX_PACKET_SIZE == 0 || (unsigned) Next::MAX_PACKET_SIZE > packet_size,
+                    "size classes must be listed from smallest to largest");
+
+      LockFreePacketPool<packet_size, packet_count> packets;
+      Next larger;
+
+    public:
+      enum {
+        MAX_PACKET_SIZE = (Next::MAX_PACKET_SIZE > 0) ? (unsigned) Next::MAX_PACKET_SIZE : packet_size
+      };
+
+    SlabPacketPool(const char *name = 0) :
+      packets(name),
+        larger(name)
+        {}
+
+      // returns a packet with room for at least length bytes, or 0
+      Packet *allocate(unsigned int length) {
+        if (length > packet_size) return larger.allocate(length);
+
+        Packet *p = try_allocate(length);
+        if (p == 0) packets.stats.failed();
+        return p;
+      }
+
+      // same as allocate(), but without counting a failure
+      Packet *try_allocate(unsigned int length) {
+        Packet *p = 0;
+
+        if (length <= packet_size) p = packets.try_allocate();
+        return (p != 0) ? p : larger.try_allocate(length);
+      }
+
+      void reset() {
+        packets.reset();
+        larger.reset();
+      }
     };
   };
 };
@@ -0,0 +1,234 @@
+// -*- Mode:C++ -*-
+
+#pragma once
+
+#include "akt/bluetooth/bluetooth_constants.h"
+#include "akt/bluetooth/packet.h"
+
+#include <cstring>
+#include <stdint.h>
+
+/**
+ * @file    pdu.h
+ * @brief   Fixed layouts of HCI and ATT PDUs
+ *
+ * @details Each layout is a struct made only of byte-aligned fields, so it
+ *          has no padding and can be laid directly over the bytes of a
+ *          Packet. pdu<L>(packet) checks once that the packet has room for
+ *          the whole layout, moves past it and returns a reference into the
+ *          packet's storage. Fields are read and written in place:
+ *
+ *            const HCI::LEConnectionComplete &e = pdu<HCI::LEConnectionComplete>(p);
+ *            if (e.status == 0) handle = e.connection_handle;
+ *
+ *          Layouts are specializations keyed by the named opcodes and event
+ *          codes in bluetooth_constants.h, so the field order lives in one
+ *          place. Each one states its size from the specification, which
+ *          the compiler checks.
+ */
+
+namespace akt {
+  namespace bluetooth {
+    /**
+     * A T stored little-endian at any alignment. On little-endian targets
+     * the conversions are a memcpy, which compiles to a single unaligned
+     * load or store on Cortex-M3/M4 and x86.
+     */
+    template<class T> class LittleEndian {
+      uint8_t bytes[sizeof(T)];
+
+    public:
+      operator T() const {
+        T x;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(&x, bytes, sizeof(T));
+#else
+        x = 0;
+        for (unsigned i=0; i < sizeof(T); ++i) x |= (T) bytes[i] << (8*i);
+#endif
+        return x;
+      }
+
+      LittleEndian &operator=(T x) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        memcpy(bytes, &x, sizeof(T));
+#else
+        for (unsigned i=0; i < sizeof(T); ++i) bytes[i] = x >> (8*i);
+#endif
+        return *this;
+      }
+    };
+
+    // returns the layout at the packet's position and moves past it
+    template<class L> inline L &pdu(Packet &p) {
+      return *(L *) p.reserve(sizeof(L)).position();
+    }
+
+#define PDU_CHECK_SIZE(layout)                                          \
+    static_assert(sizeof(layout) == layout::SIZE,                       \
+                  #layout " doesn't match the specification")
+
+    namespace HCI {
+      template<opcode O> struct CommandParameters;
+      template<opcode O> struct ReturnParameters; // of a command complete event
+      template<event E> struct EventParameters;
+      template<le_event E> struct LEEventParameters;
+
+      template<> struct CommandParameters<OPCODE_LE_SET_ADVERTISE_ENABLE> {
+        enum {SIZE = 1};
+
+        LittleEndian<uint8_t> advertising_enable;
+      };
+
+      template<> struct ReturnParameters<OPCODE_READ_LOCAL_VERSION_INFORMATION> {
+        enum {SIZE = 9};
+
+        LittleEndian<uint8_t> status;
+        LittleEndian<uint8_t> hci_version;
+        LittleEndian<uint16_t> hci_revision;
+        LittleEndian<uint8_t> lmp_version;
+        LittleEndian<uint16_t> manufacturer_name;
+        LittleEndian<uint16_t> lmp_subversion;
+      };
+
+      template<> struct ReturnParameters<OPCODE_READ_BD_ADDR> {
+        enum {SIZE = 7};
+
+        LittleEndian<uint8_t> status;
+        uint8_t bd_addr[6];
+      };
+
+      template<> struct ReturnParameters<OPCODE_READ_BUFFER_SIZE_COMMAND> {
+        enum {SIZE = 8};
+
+        LittleEndian<uint8_t> status;
+        LittleEndian<uint16_t> acl_data_packet_length;
+        LittleEndian<uint8_t> synchronous_data_packet_length;
+        LittleEndian<uint16_t> total_num_acl_data_packets;
+        LittleEndian<uint16_t> total_num_synchronous_data_packets;
+      };
+
+      template<> struct ReturnParameters<OPCODE_READ_PAGE_TIMEOUT> {
+        enum {SIZE = 3};
+
+        LittleEndian<uint8_t> status;
+        LittleEndian<uint16_t> page_timeout;
+      };
+
+      template<> struct ReturnParameters<OPCODE_LE_READ_BUFFER_SIZE> {
+        enum {SIZE = 4};
+
+        LittleEndian<uint8_t> status;
+        LittleEndian<uint16_t> le_data_packet_length;
+        LittleEndian<uint8_t> total_num_le_data_packets;
+      };
+
+      template<> struct ReturnParameters<OPCODE_LE_READ_SUPPORTED_STATES> {
+        enum {SIZE = 9};
+
+        LittleEndian<uint8_t> status;
+        uint8_t le_states[8];
+      };
+
+      template<> struct EventParameters<EVENT_DISCONNECTION_COMPLETE> {
+        enum {SIZE = 4};
+
+        LittleEndian<uint8_t> status;
+        LittleEndian<uint16_t> connection_handle;
+        LittleEndian<uint8_t> reason;
+      };
+
+      template<> struct LEEventParameters<LE_EVENT_CONNECTION_COMPLETE> {
+        enum {SIZE = 18};
+
+        LittleEndian<uint8_t> status;
+        LittleEndian<uint16_t> connection_handle;
+        LittleEndian<uint8_t> role;
+        LittleEndian<uint8_t> peer_address_type;
+        uint8_t peer_address[6];
+        LittleEndian<uint16_t> conn_interval;
+        LittleEndian<uint16_t> conn_latency;
+        LittleEndian<uint16_t> supervision_timeout;
+        LittleEndian<uint8_t> master_clock_accuracy;
+      };
+
+      PDU_CHECK_SIZE(CommandParameters<OPCODE_LE_SET_ADVERTISE_ENABLE>);
+      PDU_CHECK_SIZE(ReturnParameters<OPCODE_READ_LOCAL_VERSION_INFORMATION>);
+      PDU_CHECK_SIZE(ReturnParameters<OPCODE_READ_BD_ADDR>);
+      PDU_CHECK_SIZE(ReturnParameters<OPCODE_READ_BUFFER_SIZE_COMMAND>);
+      PDU_CHECK_SIZE(ReturnParameters<OPCODE_READ_PAGE_TIMEOUT>);
+      PDU_CHECK_SIZE(ReturnParameters<OPCODE_LE_READ_BUFFER_SIZE>);
+      PDU_CHECK_SIZE(ReturnParameters<OPCODE_LE_READ_SUPPORTED_STATES>);
+      PDU_CHECK_SIZE(EventParameters<EVENT_DISCONNECTION_COMPLETE>);
+      PDU_CHECK_SIZE(LEEventParameters<LE_EVENT_CONNECTION_COMPLETE>);
+
+      typedef CommandParameters<OPCODE_LE_SET_ADVERTISE_ENABLE> LESetAdvertiseEnable;
+      typedef ReturnParameters<OPCODE_READ_LOCAL_VERSION_INFORMATION> LocalVersionInformation;
+      typedef ReturnParameters<OPCODE_READ_BD_ADDR> ReadBDAddr;
+      typedef ReturnParameters<OPCODE_READ_BUFFER_SIZE_COMMAND> BufferSize;
+      typedef ReturnParameters<OPCODE_READ_PAGE_TIMEOUT> PageTimeout;
+      typedef ReturnParameters<OPCODE_LE_READ_BUFFER_SIZE> LEBufferSize;
+      typedef ReturnParameters<OPCODE_LE_READ_SUPPORTED_STATES> LESupportedStates;
+      typedef EventParameters<EVENT_DISCONNECTION_COMPLETE> DisconnectionComplete;
+      typedef LEEventParameters<LE_EVENT_CONNECTION_COMPLETE> LEConnectionComplete;
+    };
+
+    namespace ATT {
+      // whole PDUs, starting with the opcode
+      template<opcode O> struct PDU;
+
+      template<> struct PDU<OPCODE_ERROR> {
+        enum {SIZE = 5};
+
+        LittleEndian<uint8_t> code;
+        LittleEndian<uint8_t> request_opcode;
+        LittleEndian<uint16_t> handle;
+        LittleEndian<uint8_t> error_code;
+      };
+
+      template<> struct PDU<OPCODE_EXCHANGE_MTU_REQUEST> {
+        enum {SIZE = 3};
+
+        LittleEndian<uint8_t> code;
+        LittleEndian<uint16_t> client_rx_mtu;
+      };
+
+      template<> struct PDU<OPCODE_EXCHANGE_MTU_RESPONSE> {
+        enum {SIZE = 3};
+
+        LittleEndian<uint8_t> code;
+        LittleEndian<uint16_t> server_rx_mtu;
+      };
+
+      // the attribute type (2 or 16 bytes) follows
+      template<> struct PDU<OPCODE_READ_BY_TYPE_REQUEST> {
+        enum {SIZE = 5};
+
+        LittleEndian<uint8_t> code;
+        LittleEndian<uint16_t> starting_handle;
+        LittleEndian<uint16_t> ending_handle;
+      };
+
+      template<> struct PDU<OPCODE_READ_REQUEST> {
+        enum {SIZE = 3};
+
+        LittleEndian<uint8_t> code;
+        LittleEndian<uint16_t> attribute_handle;
+      };
+
+      PDU_CHECK_SIZE(PDU<OPCODE_ERROR>);
+      PDU_CHECK_SIZE(PDU<OPCODE_EXCHANGE_MTU_REQUEST>);
+      PDU_CHECK_SIZE(PDU<OPCODE_EXCHANGE_MTU_RESPONSE>);
+      PDU_CHECK_SIZE(PDU<OPCODE_READ_BY_TYPE_REQUEST>);
+      PDU_CHECK_SIZE(PDU<OPCODE_READ_REQUEST>);
+
+      typedef PDU<OPCODE_ERROR> ErrorResponse;
+      typedef PDU<OPCODE_EXCHANGE_MTU_REQUEST> ExchangeMTURequest;
+      typedef PDU<OPCODE_EXCHANGE_MTU_RESPONSE> ExchangeMTUResponse;
+      typedef PDU<OPCODE_READ_BY_TYPE_REQUEST> ReadByTypeRequest;
+      typedef PDU<OPCODE_READ_REQUEST> ReadRequest;
+    };
+
+#undef PDU_CHECK_SIZE
+  };
+};
@@ -61,4 +61,86 @@ namespace akt {
     uint32_t history[DWELL];
     unsigned next;
   };
+
+  /**
+   * A bank of 128 switches for VerticalDebounce, on targets without a
+   * 128-bit integer.
+   */
+  struct Lanes128 {
+    uint64_t lo, hi;
+
+    Lanes128(uint64_t l = 0, uint64_t h = 0) : lo(l), hi(h) {}
+
+    Lanes128 operator&(const Lanes128 &b) const {return Lanes128(lo & b.lo, hi & b.hi);}
+    Lanes128 operator|(const Lanes128 &b) const {return Lanes128(lo | b.lo, hi | b.hi);}
+    Lanes128 operator^(const Lanes128 &b) const {return Lanes128(lo ^ b.lo, hi ^ b.hi);}
+    Lanes128 operator~() const {return Lanes128(~lo, ~hi);}
+
+    bool operator==(const Lanes128 &b) const {return lo == b.lo && hi == b.hi;}
+    bool operator!=(const Lanes128 &b) const {return !(*this == b);}
+    explicit operator bool() const {return (lo | hi) != 0;}
+  };
+
+  /**
+   * VerticalDebounce debounces a bank of switches, one per bit of Lanes
+   * (uint32_t, uint64_t or Lanes128), in both directions: a switch's
+   * state follows its raw value once that has differed from the state for
+   * Dwell updates in a row. Each switch has a counter of those updates,
+   * stored "vertically" with bit k of every counter in the word count[k],
+   * so one update is a handful of bitwise operations per counter bit for
+   * the whole bank, instead of one pass over Dwell words of history.
+   *
+   * Presses behave exactly like Debounce with the same dwell, but releases
+   * are debounced too, where Debounce releases on the first open reading.
+   */
+  template<class Lanes = uint32_t, unsigned Dwell = Debounce::DWELL>
+    class VerticalDebounce {
+    static_assert(Dwell >= 1, "Dwell must be at least one update");
+
+    // bits needed to count up to Dwell - 1
+    static constexpr unsigned bits(unsigned n) {return n <= 1 ? 1 : 1 + bits(n >> 1);}
+
+  public:
+    enum {DWELL = Dwell, COUNTER_BITS = bits(Dwell - 1)};
+
+    VerticalDebounce() {
+      reset();
+    }
+
+    void reset() {
+      debounced_state = Lanes();
+      for (unsigned k=0; k < COUNTER_BITS; ++k) count[k] = Lanes();
+    }
+
+    // returns the switches that changed state
+    Lanes update(Lanes raw_switch_values) {
+      Lanes differs = raw_switch_values ^ debounced_state;
+
+      // lanes whose counters already hold Dwell - 1
+      Lanes full = differs;
+      for (unsigned k=0; k < COUNTER_BITS; ++k) {
+        full = full & (((Dwell - 1) >> k) & 1 ? count[k] : ~count[k]);
+      }
+
+      debounced_state = debounced_state ^ full;
+
+      // count up where the raw value differs, and start over everywhere else
+      Lanes carry = differs, keep = differs & ~full;
+      for (unsigned k=0; k < COUNTER_BITS; ++k) {
+        Lanes next_carry = count[k] & carry;
+        count[k] = (count[k] ^ carry) & keep;
+        carry = next_carry;
+      }
+
+      return full;
+    }
+
+    Lanes state() const {
+      return debounced_state;
+    }
+
+  private:
+    Lanes debounced_state;
+    Lanes count[COUNTER_BITS];
+  };
 };
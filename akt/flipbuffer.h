@@ -94,6 +94,18 @@ namespace akt {
       assert(pos+offset <= lim);
       pos += offset;
     }
+
+    /**
+     * Checks once that n elements fit, moves past them and returns a
+     * pointer to the first. Callers that read or write a whole record
+     * can then skip the per-element checks of operator<< and operator>>.
+     */
+    T *reserve(unsigned n) {
+      assert(pos+n <= lim);
+      T *p = storage + pos;
+      pos += n;
+      return p;
+    }
   
     FlipBuffer &operator<<(T x) {
       assert(pos+sizeof(x) <= lim);
@@ -172,6 +184,77 @@ namespace akt {
     */
   };
 
+  /**
+   * ByteCursor reads and writes little-endian fields through a raw pointer
+   * without any bounds checks. It's meant to be used on a region that has
+   * already been checked, e.g., one returned by FlipBuffer::reserve():
+   *
+   *   packet.reserve(5) << opcode << handle << (uint16_t) value;
+   */
+  class ByteCursor {
+    uint8_t *p;
+
+  public:
+    ByteCursor(uint8_t *ptr) : p(ptr) {}
+
+    uint8_t *position() const {return p;}
+
+    ByteCursor &operator<<(uint8_t x) {
+      *p++ = x;
+      return *this;
+    }
+
+    ByteCursor &operator<<(uint16_t x) {
+      p[0] = x;
+      p[1] = x >> 8;
+      p += 2;
+      return *this;
+    }
+
+    ByteCursor &operator<<(uint32_t x) {
+      p[0] = x;
+      p[1] = x >> 8;
+      p[2] = x >> 16;
+      p[3] = x >> 24;
+      p += 4;
+      return *this;
+    }
+
+    ByteCursor &operator>>(uint8_t &x) {
+      x = *p++;
+      return *this;
+    }
+
+    ByteCursor &operator>>(uint16_t &x) {
+      x = p[0] + (p[1] << 8);
+      p += 2;
+      return *this;
+    }
+
+    ByteCursor &operator>>(uint32_t &x) {
+      x = p[0] + (p[1] << 8) + (p[2] << 16) + ((uint32_t) p[3] << 24);
+      p += 4;
+      return *this;
+    }
+
+    ByteCursor &read(void *dst, unsigned len) {
+      memcpy(dst, p, len);
+      p += len;
+      return *this;
+    }
+
+    ByteCursor &write(const void *src, unsigned len) {
+      memcpy(p, src, len);
+      p += len;
+      return *this;
+    }
+
+    ByteCursor &skip(unsigned len) {
+      p += len;
+      return *this;
+    }
+  };
+
   template<class T, unsigned S> class SizedFlipBuffer : public FlipBuffer<T> {
   protected:
     T data[S];
@@ -1,11 +1,28 @@
 // -*- Mode:C++ -*-
 #pragma once
 
+#include "akt/assert.h"
+
 #include <cstring>
+#include <stdint.h>
+#include <type_traits>
 
 namespace akt {
+  // Maps a running index onto a ring of N slots. Powers of two mask
+  // instead of dividing, which matters on a Cortex-M without a fast divide.
+  template<unsigned N, bool PowerOfTwo = (N & (N - 1)) == 0>
+    struct RingIndex {
+      static unsigned wrap(unsigned i) {return i % N;}
+    };
+
+  template<unsigned N>
+    struct RingIndex<N, true> {
+      static unsigned wrap(unsigned i) {return i & (N - 1);}
+    };
+
   template<class T, unsigned N>
   class History {
+  protected:
     T data[N];
     bool full;
     unsigned idx;
@@ -37,8 +54,130 @@ namespace akt {
       return *this;
     }
 
-    T &operator[](int n) {
-      return data[(idx - (n + 1)) % N];
+    // n samples ago, so [0] is the latest
+    T &operator[](unsigned n) {
+      assert(n < N);
+      return data[RingIndex<N>::wrap(idx + N - 1 - n)];
+    }
+
+    const T &operator[](unsigned n) const {
+      assert(n < N);
+      return data[RingIndex<N>::wrap(idx + N - 1 - n)];
     }
   };
+
+  /**
+   * WindowedStats is a History that also keeps the mean, variance, minimum
+   * and maximum of the samples it holds, updated in O(1) amortized time per
+   * sample instead of rescanning the window. The sums are kept in 64-bit
+   * integers for integral types (plenty for 16-bit samples, but not for
+   * squaring full range 32-bit ones), and in doubles otherwise. The minimum
+   * and maximum come from monotonic queues of the samples that can still
+   * become the extreme once older ones leave the window.
+   *
+   * The History is inherited privately, so samples can only be read back,
+   * since changing one in place would leave the sums and queues stale.
+   */
+  template<class T, unsigned N,
+           class Sum = typename std::conditional<std::is_integral<T>::value, int64_t, double>::type>
+  class WindowedStats : private History<T, N> {
+    typedef History<T, N> Base;
+    typedef RingIndex<N> Index;
+
+    // samples in arrival order, each one more extreme than those after it
+    class MonotonicQueue {
+      struct Entry {
+        T value;
+        unsigned sequence;
+      } entries[N];
+      unsigned head, length;
+
+      Entry &back() {return entries[Index::wrap(head + length - 1)];}
+
+    public:
+      void reset() {head = length = 0;}
+
+      const T &front() const {return entries[head].value;}
+
+      // Before is the order that keeps a value at the front, e.g., for a
+      // maximum anything less than or equal to a new sample is dropped.
+      template<class Before>
+      void push(T value, unsigned sequence, Before before) {
+        // the front leaves once it's N samples old, making room for value
+        if (length > 0 && sequence - entries[head].sequence >= N) {
+          head = Index::wrap(head + 1);
+          length -= 1;
+        }
+
+        while (length > 0 && !before(back().value, value)) length -= 1;
+
+        length += 1;
+        back().value = value;
+        back().sequence = sequence;
+      }
+    };
+
+    static bool greater(T a, T b) {return a > b;}
+    static bool less(T a, T b) {return a < b;}
+
+    MonotonicQueue maxima, minima;
+    unsigned sequence;
+    Sum sum, sum_of_squares;
+
+  public:
+    enum {SIZE=N};
+
+    WindowedStats() {reset();}
+
+    using Base::count;
+
+    // n samples ago, so [0] is the latest
+    const T &operator[](unsigned n) const {return Base::operator[](n);}
+
+    void reset() {
+      Base::reset();
+      maxima.reset();
+      minima.reset();
+      sequence = 0;
+      sum = sum_of_squares = 0;
+    }
+
+    WindowedStats &operator+=(T sample) {
+      if (this->full) {
+        Sum leaving = this->data[this->idx];
+
+        sum -= leaving;
+        sum_of_squares -= leaving*leaving;
+      }
+
+      Base::operator+=(sample);
+      sum += sample;
+      sum_of_squares += (Sum) sample*sample;
+
+      maxima.push(sample, sequence, greater);
+      minima.push(sample, sequence, less);
+      sequence += 1;
+
+      return *this;
+    }
+
+    // the window must have at least one sample for these
+    T max() const {return maxima.front();}
+    T min() const {return minima.front();}
+    T range() const {return max() - min();}
+
+    // for integral T, mean() truncates toward zero
+    T mean() const {return sum/(Sum) this->count();}
+
+    // Population variance of the window. For integral T the sums are exact
+    // but the final division truncates; for floating point the result is
+    // kept from going negative through cancellation.
+    Sum variance() const {
+      Sum n = this->count();
+      Sum v = (n*sum_of_squares - sum*sum)/(n*n);
+      return v > 0 ? v : 0;
+    }
+
+    Sum total() const {return sum;}
+  };
 };
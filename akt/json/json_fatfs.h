@@ -22,7 +22,7 @@ namespace akt {
       bool read_file(const char *filename);
     };
 
-    class FATFSWriter : public WriterBase {
+    class FATFSWriter : public SizedWriter<100> {
       FIL fil;
 
     protected:
@@ -1,10 +1,110 @@
 #include <cstring>
 #include <cstdlib>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "akt/json/reader.h"
 
 using namespace akt::json;
 
+/*
+ * Whitespace between tokens and the contents of strings come in runs, so
+ * rather than going around the state machine once per byte, read() scans
+ * ahead for the end of the run, 16 bytes at a time with SSE2 on hosts and
+ * a 32-bit word at a time elsewhere (SWAR, two words per step for strings),
+ * and string runs are copied into the token in one go. Scans only look at
+ * whole chunks before the limit and leave the tail to the caller.
+ */
+namespace {
+#if defined(__SSE2__)
+  enum {SCAN_WIDTH = 16};
+
+  inline __m128i load(const char *p) {return _mm_loadu_si128((const __m128i *) p);}
+  inline __m128i splat(char c) {return _mm_set1_epi8(c);}
+
+  inline const char *skip_whitespace(const char *p, const char *limit) {
+    for (; p + SCAN_WIDTH <= limit; p += SCAN_WIDTH) {
+      __m128i v = load(p);
+      __m128i space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, splat(' ')), _mm_cmpeq_epi8(v, splat('\n'))),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, splat('\r')), _mm_cmpeq_epi8(v, splat('\t'))));
+      unsigned other = ~_mm_movemask_epi8(space) & 0xffff;
+
+      if (other) return p + __builtin_ctz(other);
+    }
+
+    return p;
+  }
+
+  // finds the first '"', '\\' or '\0'
+  inline const char *find_string_end(const char *p, const char *limit) {
+    for (; p + SCAN_WIDTH <= limit; p += SCAN_WIDTH) {
+      __m128i v = load(p);
+      __m128i end = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, splat('"')), _mm_cmpeq_epi8(v, splat('\\'))),
+                                 _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+      unsigned found = _mm_movemask_epi8(end);
+
+      if (found) return p + __builtin_ctz(found);
+    }
+
+    return p;
+  }
+#else
+  typedef uint32_t Word;
+  const Word ONES = 0x01010101, LOW7 = 0x7f7f7f7f;
+
+  inline Word load(const char *p) {
+    Word w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+  }
+
+  // 0x80 in exactly the bytes of w that are zero
+  inline Word zero_bytes(Word w) {
+    return ~(((w & LOW7) + LOW7) | w | LOW7);
+  }
+
+  inline Word equal_bytes(Word w, char c) {
+    return zero_bytes(w ^ (ONES * (uint8_t) c));
+  }
+
+  // the index of the first flagged byte, in memory order
+  inline unsigned first_byte(Word flags) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_ctz(flags) / 8;
+#else
+    return __builtin_clz(flags) / 8;
+#endif
+  }
+
+  inline const char *skip_whitespace(const char *p, const char *limit) {
+    for (; p + sizeof(Word) <= limit; p += sizeof(Word)) {
+      Word w = load(p);
+      Word other = ~(equal_bytes(w, ' ') | equal_bytes(w, '\n') | equal_bytes(w, '\r') | equal_bytes(w, '\t')) & (ONES << 7);
+
+      if (other) return p + first_byte(other);
+    }
+
+    return p;
+  }
+
+  inline const char *find_string_end(const char *p, const char *limit) {
+    for (; p + 2*sizeof(Word) <= limit; p += 2*sizeof(Word)) {
+      Word a = load(p), b = load(p + sizeof(Word));
+      Word end_a = equal_bytes(a, '"') | equal_bytes(a, '\\') | zero_bytes(a);
+      Word end_b = equal_bytes(b, '"') | equal_bytes(b, '\\') | zero_bytes(b);
+
+      if (end_a) return p + first_byte(end_a);
+      if (end_b) return p + sizeof(Word) + first_byte(end_b);
+    }
+
+    return p;
+  }
+#endif
+}
+
 enum state_t {
   // whitespace is significant for these states
   ERROR,
@@ -30,56 +130,65 @@ enum state_t {
   COMPLETE,
 };
 
-Reader::Reader(char *token_buffer, unsigned len) {
+// Only the states that follow a nested value are ever pushed, and they're
+// adjacent in state_t, so they're stored relative to the first of them.
+static_assert(COMPLETE - EXPECT_NEXT_MEMBER < (1 << ReaderBase::STATE_BITS),
+              "pushed states don't fit in STATE_BITS");
+
+ReaderBase::ReaderBase(char *token_buffer, unsigned len, BitStackBase<STATE_BITS> &stack) :
+  stack(stack)
+{
   token.buffer = token_buffer;
   token.max = len;
   token.pos = 0;
 }
 
-bool Reader::is_done() const {
+bool ReaderBase::is_done() const {
   return state == COMPLETE || state == ERROR;
 }
 
-bool Reader::had_error() const {
+bool ReaderBase::had_error() const {
   return state == ERROR;
 }
 
-void Reader::push(int state) {
-  if (!stack.full()) {
-    stack.push(state);
-  } else {
+void ReaderBase::push(int state) {
+  if (state < EXPECT_NEXT_MEMBER || state > COMPLETE || stack.full()) {
     error();
+  } else {
+    stack.push(state - EXPECT_NEXT_MEMBER);
   }
 }
 
-void Reader::pop(int &state) {
-  if (!stack.empty()) {
-    stack.pop(state);
+void ReaderBase::pop(int &state) {
+  unsigned s;
+
+  if (stack.pop(s)) {
+    state = EXPECT_NEXT_MEMBER + s;
   } else {
     error();
   }
 }
 
-void Reader::reset(Visitor *visitor) {
+void ReaderBase::reset(Visitor *visitor) {
   stack.reset();
   state = EXPECT_OBJECT_OR_ARRAY;
   delegate = visitor;
 }
 
-void Reader::error() {
+void ReaderBase::error() {
   state = ERROR;
   stack.reset();
   if (delegate) delegate->error();
 }
 
-inline bool Reader::is_whitespace(char ch) {
+inline bool ReaderBase::is_whitespace(char ch) {
   switch (ch) {
   case ' ' : case '\r' : case '\n' : case '\t' : return true;
   default  : return false;
   }
 }
 
-void Reader::handle_keyword() {
+void ReaderBase::handle_keyword() {
   if (!strcmp("true", token.buffer)) {
     delegate->literal_true();
   } else if (!strcmp("false", token.buffer)) {
@@ -91,20 +200,36 @@ void Reader::handle_keyword() {
   }
 }
 
-void Reader::handle_integer() {
+void ReaderBase::handle_integer() {
   delegate->num_int((int) atoi(token.buffer));
 }
 
-void Reader::handle_number() {
+void ReaderBase::handle_number() {
   delegate->num_float((float) atof(token.buffer));
 }
 
-void Reader::read(const char *text, unsigned len) {
+void ReaderBase::read(const char *text, unsigned len) {
   const char *limit = text + len;
 
   if (delegate == 0) return;
 
   while (text < limit) {
+    if (state > GATHER_STRING) {
+      // most runs are empty or a single space
+      if (is_whitespace(*text)) {
+        text = skip_whitespace(text + 1, limit);
+        while (text < limit && is_whitespace(*text)) ++text;
+        if (text == limit) break;
+      }
+    } else if (state == GATHER_STRING) {
+      const char *run = find_string_end(text, limit);
+
+      while (run < limit && *run != '"' && *run != '\\' && *run != '\0') ++run;
+      append_tokens(text, run - text);
+      text = run;
+      if (text == limit || state == ERROR) break;
+    }
+
     const char ch(*text++);
 
     if (ch == '\0') {
@@ -142,6 +267,7 @@ void Reader::read(const char *text, unsigned len) {
           string_is_name = true;
           state_after_value = EXPECT_MEMBER_SEPARATOR;
           state = GATHER_STRING;
+          start_token();
         } else if (ch == '}') {
           delegate->object_end();
           pop(state);
@@ -270,6 +396,8 @@ void Reader::read(const char *text, unsigned len) {
         break;
 
       case GATHER_STRING_ESCAPED :
+        state = GATHER_STRING;
+
         switch (ch) {
         case '"' :
           append_token('"');
@@ -471,20 +599,29 @@ void Reader::read(const char *text, unsigned len) {
   }
 }
 
-void Reader::start_token() {
+void ReaderBase::start_token() {
   token.pos = 0;
 }
 
-void Reader::append_token(char ch) {
-  if (token.pos < sizeof(token.buffer)) {
+void ReaderBase::append_token(char ch) {
+  if (token.pos < token.max) {
     token.buffer[token.pos++] = ch;
   } else {
     error();
   }
 }
 
-void Reader::finish_token() {
-  if (token.pos < sizeof(token.buffer)) {
+void ReaderBase::append_tokens(const char *run, unsigned len) {
+  if (len <= token.max - token.pos) {
+    memcpy(token.buffer + token.pos, run, len);
+    token.pos += len;
+  } else {
+    error();
+  }
+}
+
+void ReaderBase::finish_token() {
+  if (token.pos < token.max) {
     token.buffer[token.pos++] = '\0';
   } else {
     error();
@@ -2,11 +2,21 @@
 #pragma once
 
 #include "akt/json/visitor.h"
-#include "akt/stack.h"
+#include "akt/bitstack.h"
 
 namespace akt {
   namespace json {
-    class Reader {
+    /**
+     * ReaderBase is the JSON parser. Each level of nesting only needs to
+     * remember which state follows the nested value, which takes
+     * STATE_BITS bits. The stack is supplied by a subclass, so the
+     * maximum nesting depth is set by SizedReader's template parameter.
+     */
+    class ReaderBase {
+    public:
+      enum {STATE_BITS = 2};
+
+    private:
       struct {
         char *buffer;
         unsigned pos;
@@ -17,7 +27,7 @@ namespace akt {
       bool string_is_name;
       unsigned unicode_digit_count;
       unsigned long unicode_value;
-      Stack<int, 100> stack;
+      BitStackBase<STATE_BITS> &stack;
       void push(int s);
       void pop(int &s);
 
@@ -26,6 +36,7 @@ namespace akt {
       void error();
       void start_token();
       void append_token(char ch);
+      void append_tokens(const char *run, unsigned len);
       void finish_token();
       void handle_keyword();
       void handle_integer();
@@ -33,13 +44,27 @@ namespace akt {
 
       bool is_whitespace(char ch);
 
+    protected:
+      ReaderBase(char *token_buffer, unsigned len, BitStackBase<STATE_BITS> &stack);
+
     public:
-      Reader(char *token_buffer, unsigned len);
 
       void reset(Visitor *delegate);
       void read(const char *text, unsigned len);
       bool is_done() const;
       bool had_error() const;
     };
+
+    template<unsigned Depth> class SizedReader : public ReaderBase {
+      BitStack<STATE_BITS, Depth> states;
+
+    public:
+      SizedReader(char *token_buffer, unsigned len) :
+        ReaderBase(token_buffer, len, states)
+      {
+      }
+    };
+
+    typedef SizedReader<100> Reader;
   }
 }
@@ -6,8 +6,11 @@
 using namespace akt::json;
 using namespace std;
 
-WriterBase::WriterBase() :
-  had_error(false)
+WriterBase::WriterBase(BitStackBase<1> &stack) :
+  had_error(false),
+  skip_next_comma(false),
+  needs_new_line(false),
+  stack(stack)
 {
 }
 
@@ -37,7 +40,7 @@ void WriterBase::object_end() {
     unsigned count;
     stack.pop(count);
     write("}");
-    if (!stack.empty()) stack.top()++;
+    count_value();
     write_newline_if_necessary();
   }
 }
@@ -63,7 +66,7 @@ void WriterBase::array_end() {
     unsigned count;
     stack.pop(count);
     write("]");
-    if (!stack.empty()) stack.top()++;
+    count_value();
     write_newline_if_necessary();
   }
 }
@@ -87,7 +90,7 @@ void WriterBase::string(const char *text) {
   write_quoted(text);
   write('"');
 
-  if (!stack.empty()) stack.top()++;
+  count_value();
 }
 
 void WriterBase::write_quoted(const char *str) {
@@ -101,7 +104,7 @@ void WriterBase::literal_true() {
 
   write("true");
 
-  if (!stack.empty()) stack.top()++;
+  count_value();
 }
 
 void WriterBase::literal_false() {
@@ -110,7 +113,7 @@ void WriterBase::literal_false() {
 
   write("false");
 
-  if (!stack.empty()) stack.top()++;
+  count_value();
 }
 
 void WriterBase::literal_null() {
@@ -119,7 +122,7 @@ void WriterBase::literal_null() {
 
   write("null");
 
-  if (!stack.empty()) stack.top()++;
+  count_value();
 }
 
 void WriterBase::num_int(int32_t n) {
@@ -131,7 +134,7 @@ void WriterBase::num_int(int32_t n) {
   snprintf(buffer, sizeof(buffer), "%d", (int) n);
   write(buffer);
 
-  if (!stack.empty()) stack.top()++;
+  count_value();
 }
 
 void WriterBase::num_float(float n) {
@@ -143,7 +146,7 @@ void WriterBase::num_float(float n) {
   snprintf(buffer, sizeof(buffer), "%g", n);
   write(buffer);
 
-  if (!stack.empty()) stack.top()++;
+  count_value();
 }
 
 void WriterBase::error() {
@@ -153,6 +156,10 @@ void WriterBase::error() {
   had_error = true;
 }
 
+void WriterBase::count_value() {
+  if (!stack.empty()) stack.replace_top(1);
+}
+
 void WriterBase::write_comma_if_necessary() {
   if (!skip_next_comma && !stack.empty() && stack.top() > 0) write(", ");
   skip_next_comma = false;
@@ -6,7 +6,7 @@
 #endif
 
 #include "akt/json/visitor.h"
-#include "akt/stack.h"
+#include "akt/bitstack.h"
 
 #if defined(USE_JSON_STREAMS)
 #include <ostream>
@@ -15,9 +15,15 @@
 
 namespace akt {
   namespace json {
+    /**
+     * Each level of nesting only has to remember whether it already holds
+     * a value (and thus needs a comma before the next one), so the stack
+     * takes one bit per level. It's supplied by a subclass, usually via
+     * SizedWriter, which sets the maximum nesting depth.
+     */
     class WriterBase : public Visitor {
       bool had_error, skip_next_comma, needs_new_line;
-      Stack<unsigned, 100> stack;
+      BitStackBase<1> &stack;
 
     protected:
       virtual void write(char c) = 0;
@@ -28,9 +34,11 @@ namespace akt {
       void write_comma_if_necessary();
       void newline_and_indent();
       void write_newline_if_necessary();
+      void count_value();
+
+      WriterBase(BitStackBase<1> &stack);
 
     public:
-      WriterBase();
 
       virtual void reset();
       virtual void object_begin();
@@ -48,13 +56,23 @@ namespace akt {
       virtual void newline();
     };
 
+    template<unsigned Depth> class SizedWriter : public WriterBase {
+      BitStack<1, Depth> levels;
+
+    public:
+      SizedWriter() :
+        WriterBase(levels)
+      {
+      }
+    };
+
 #if defined(USE_JSON_STREAMS)
-    class StreamWriter : public WriterBase {
+    class StreamWriter : public SizedWriter<100> {
       std::ostream &out;
 
     public:
       StreamWriter(std::ostream &out) :
-        WriterBase(),
+        SizedWriter(),
         out(out)
       {
       }
@@ -10,12 +10,13 @@
 using namespace akt;
 
 LogBase::LogBase(const char *name, void *storage, size_t len) :
-  fifo((char *) storage, len),
+  fifo(storage, len),
+  partial(0),
   output_thread(*this, name),
   bytes_lost(0)
 {
-  chMtxInit(&mutex);
-  chCondInit(&not_empty);
+  chMtxInit(&consumer);
+  chBSemInit(&not_empty, TRUE);
 }
 
 void LogBase::start() {
@@ -23,60 +24,85 @@ void LogBase::start() {
 }
 
 int LogBase::printf(const char *format, ...) {
-  static char buf[256];
-  va_list args;
+  va_list args, measure;
   int count;
 
+  // measure first, so that the text can be formatted into its record
   va_start(args, format);
-  count = vsnprintf(buf, sizeof(buf), format, args);
-  write(buf, (size_t) count);
-  va_end(args);
+  va_copy(measure, args);
+  count = vsnprintf(0, 0, format, measure);
+  va_end(measure);
+
+  if (count > 0) {
+    // room for the nul vsnprintf() always writes, which isn't committed
+    size_t len = (size_t) count + 1;
+    if (len > fifo.max_record()) len = fifo.max_record();
+
+    char *record = fifo.claim(len);
+
+    if (record != 0) {
+      vsnprintf(record, len, format, args);
+      fifo.commit(record, len - 1);
+      bytes_lost += (size_t) count - (len - 1);
+      chBSemSignal(&not_empty);
+    } else {
+      bytes_lost += (size_t) count;
+    }
+  }
 
+  va_end(args);
   return count;
 }
 
 size_t LogBase::write(const char *bytes, size_t len) {
   size_t written = 0;
 
-  chMtxLock(&mutex);
-  if (len > 0) {
-    written = fifo.write(bytes, len);
+  // anything longer than a single record is split into several
+  while (written < len) {
+    size_t n = len - written;
+    if (n > fifo.max_record()) n = fifo.max_record();
 
-    if (written < len) {
-      bytes_lost += len - written;
-    }
+    if (!fifo.write(bytes + written, n)) break;
+    written += n;
+  }
 
-    if (written > 0) {
-      chCondSignal(&not_empty);
-    }
+  if (written < len) {
+    bytes_lost += len - written;
   }
 
-  chMtxUnlock();
+  if (written > 0) {
+    chBSemSignal(&not_empty);
+  }
 
   return written;
 }
 
-void LogBase::flush() {
-  chMtxLock(&mutex);
+bool LogBase::drain() {
+  const char *record;
+  size_t len;
 
-  // there will be at most two contiguous chunks in the ring buffer,
-  // so try to write both.
-  for (int i=0; i < 2; ++i) {
-    size_t available, saved=0;
+  while ((record = fifo.peek(len)) != 0) {
+    size_t saved = save(record + partial, len - partial);
 
-    available = fifo.contiguous_read_capacity();
-    if (available > 0) {
-      saved = save(&fifo.peek(0), available);
-      fifo.skip(saved);
-    }
+    partial += saved;
+    if (partial < len) return false; // couldn't write everything
 
-    if (saved < available) {
-      // couldn't write everything
-      break;
-    }
+    fifo.consume();
+    partial = 0;
+  }
+
+  return true;
+}
+
+void LogBase::flush() {
+  chMtxLock(&consumer);
+
+  // save whatever can be saved and discard the rest
+  if (!drain()) {
+    fifo.flush();
+    partial = 0;
   }
 
-  fifo.flush();
   chMtxUnlock();
 }
 
@@ -91,30 +117,12 @@ LogBase::OutputThread::OutputThread(LogBase &log, const char *name) :
 
 msg_t LogBase::OutputThread::run() {
   for (;;) {
-    chMtxLock(&log.mutex);
-    msg_t reason = chCondWaitTimeout(&log.not_empty,
-                                     MS2ST(IDLE_TIMEOUT_MS));
-
-    // if the wait timed out, the mutex won't be locked, so do that now
-    if (reason == RDY_TIMEOUT) chMtxLock(&log.mutex);
+    msg_t reason = chBSemWaitTimeout(&log.not_empty, MS2ST(IDLE_TIMEOUT_MS));
 
     // save whatever we can, regardless of whether someone wrote to
     // the FIFO or there was a timeout
-    size_t available, saved = 0;
-    available = log.fifo.contiguous_read_capacity();
-
-    if (available > 0) {
-      chMtxUnlock();
-      saved = log.save(&log.fifo.peek(0), available);
-      chMtxLock(&log.mutex);
-
-      log.fifo.skip(saved);
-    }
-
-    if (saved < available) {
-      // data was lost
-    }
-
+    chMtxLock(&log.consumer);
+    log.drain();
     chMtxUnlock();
 
     if (reason == RDY_TIMEOUT) log.idle();
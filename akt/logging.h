@@ -1,6 +1,6 @@
 #pragma once
 
-#include "akt/ringbuffer.h"
+#include "akt/logring.h"
 #include "akt/thread.h"
 
 #include "ch.h"
@@ -17,21 +17,28 @@ namespace akt {
    * thread safe fashion. An internal thread reads data from the FIFO and writes
    * it out somewhere else (e.g., to a console or file).
    *
-   * LogBase instances use a monitor pattern to ensure that writes to the FIFO
-   * are serialized and atomic.
-   * See: http://en.wikipedia.org/wiki/Monitor_(synchronization))
+   * The FIFO is a LogRing, so each write() or printf() becomes one record
+   * that is claimed and committed without taking a lock. Writers never wait
+   * for each other or for the OutputThread, and each record is saved
+   * atomically with respect to other writers. Text longer than the ring's
+   * max_record() is split into several records, which another writer's
+   * records may fall between. printf() measures its text first and then
+   * formats it straight into one record, so it needs no buffer of its own;
+   * text longer than max_record() is truncated and counted in bytes_lost.
    *
    * Subclassers must implement the save() method which is responsible for
    * reading accumulated log data from the FIFO. Subclassers may also implement
    * the idle() method, which is called periodically when there is no other
    * activity. Both save() and idle() are called in the context of the
-   * OutputThread but while the mutex is unlocked.
+   * OutputThread (or of a thread calling flush()) with the consumer mutex
+   * held, which writers never touch.
    */
   class LogBase {
   protected:
-    Mutex mutex;
-    CondVar not_empty;
-    akt::RingBuffer<char> fifo;
+    Mutex consumer;
+    BinarySemaphore not_empty;
+    akt::LogRing fifo;
+    size_t partial; // bytes of the oldest record already saved
             
     // This helper thread pulls data out of the fifo in the background
     class OutputThread : public akt::ChibiThread<512> {
@@ -43,10 +50,12 @@ namespace akt {
       virtual msg_t run() override;
     } output_thread;
 
-    // These methods are called by the OutputThread outside of the mutex lock
+    // These methods are called by the OutputThread
     virtual size_t save(const char *bytes, size_t len) = 0;
     virtual void idle() {}
 
+    bool drain();
+
   public:
     LogBase(const char *name, void *storage, size_t len);
 
@@ -56,7 +65,7 @@ namespace akt {
     virtual void flush();
     virtual bool is_logging() const;
 
-    size_t bytes_lost;
+    std::atomic<size_t> bytes_lost;
   };
 
   /**
@@ -65,7 +74,7 @@ namespace akt {
    */
   class ConsoleLog : public LogBase {
     BaseSequentialStream *tty;
-    char buffer[32];
+    char buffer[128] __attribute__ ((aligned(4)));
 
   protected:
     virtual size_t save(const char *bytes, size_t len) override;
@@ -0,0 +1,119 @@
+#include "akt/logring.h"
+#include "akt/assert.h"
+
+#include <cstring>
+
+using namespace akt;
+
+LogRing::LogRing(void *s, size_t len) :
+  head(0),
+  tail(0),
+  current_size(0)
+{
+  // header words are accessed atomically, so they need natural alignment
+  uintptr_t aligned = ((uintptr_t) s + (HEADER_SIZE-1)) & ~(uintptr_t) (HEADER_SIZE-1);
+  len -= (size_t) (aligned - (uintptr_t) s);
+  storage = (char *) aligned;
+
+  // the size field is 16 bits, so anything beyond 64K would be wasted
+  if (len > 0x10000) len = 0x10000;
+
+  capacity = 1;
+  while (capacity*2 <= len) capacity *= 2;
+  assert(capacity >= 4*HEADER_SIZE);
+  mask = capacity - 1;
+
+  memset(storage, 0, capacity);
+}
+
+size_t LogRing::max_record() const {
+  // Limiting records to half the ring guarantees that an empty ring always
+  // has room, even when the record needs a padding record in front of it.
+  size_t max = capacity/2 - HEADER_SIZE;
+  return (max < LENGTH_MASK) ? max : LENGTH_MASK;
+}
+
+char *LogRing::claim(size_t len) {
+  if (len > max_record()) return 0;
+
+  uint32_t need = HEADER_SIZE + ((len + (HEADER_SIZE-1)) & ~(HEADER_SIZE-1));
+  uint32_t h = head.load(std::memory_order_relaxed);
+  uint32_t pad;
+
+  do {
+    uint32_t t = tail.load(std::memory_order_acquire);
+    uint32_t pos = h & mask;
+
+    pad = (pos + need > capacity) ? capacity - pos : 0;
+    if ((h + pad + need) - t > capacity) return 0; // full
+  } while (!head.compare_exchange_weak(h, h + pad + need,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed));
+
+  // The claimed bytes are ours alone now. The consumer stops at the first
+  // uncommitted header, so a padding record is committed immediately and
+  // the real record just records its size until commit() is called.
+  if (pad > 0) {
+    header(h).store(COMMITTED | pad, std::memory_order_release);
+  }
+
+  header(h + pad).store(need, std::memory_order_relaxed);
+  return storage + ((h + pad) & mask) + HEADER_SIZE;
+}
+
+void LogRing::commit(char *record, size_t len) {
+  std::atomic<uint32_t> &hdr = *(std::atomic<uint32_t> *) (record - HEADER_SIZE);
+  uint32_t size = hdr.load(std::memory_order_relaxed) & SIZE_MASK;
+
+  assert(len + HEADER_SIZE <= size);
+  hdr.store(COMMITTED | (len << LENGTH_SHIFT) | size, std::memory_order_release);
+}
+
+bool LogRing::write(const char *bytes, size_t len) {
+  char *record = claim(len);
+
+  if (record == 0) return false;
+
+  memcpy(record, bytes, len);
+  commit(record, len);
+  return true;
+}
+
+const char *LogRing::peek(size_t &len) {
+  for (;;) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t hdr = header(t).load(std::memory_order_acquire);
+
+    if ((hdr & COMMITTED) == 0) return 0; // empty, or next record not done yet
+
+    current_size = hdr & SIZE_MASK;
+    len = (hdr >> LENGTH_SHIFT) & LENGTH_MASK;
+
+    if (len > 0) return storage + (t & mask) + HEADER_SIZE;
+
+    release(current_size); // padding (or an empty record)
+  }
+}
+
+void LogRing::consume() {
+  assert(current_size > 0);
+  release(current_size);
+  current_size = 0;
+}
+
+void LogRing::release(uint32_t size) {
+  uint32_t t = tail.load(std::memory_order_relaxed);
+
+  // zero the whole record, since a later header may land anywhere in it
+  memset(storage + (t & mask), 0, size);
+  tail.store(t + size, std::memory_order_release);
+}
+
+void LogRing::flush() {
+  size_t len;
+  while (peek(len)) consume();
+}
+
+bool LogRing::empty() const {
+  return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+}
@@ -0,0 +1,70 @@
+// -*- Mode:C++ -*-
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+namespace akt {
+  /**
+   * LogRing is a multi-producer, single-consumer FIFO of variable length
+   * records. Producers never block: each one claims space for a whole record
+   * with a single compare-and-swap, fills it in place and then commits it.
+   * Producers that claim concurrently get disjoint records and don't wait
+   * for each other. The consumer only ever sees fully committed records,
+   * in the order they were claimed.
+   *
+   * Every record starts with a 32-bit header word:
+   *
+   *   bits  0-15  size of the record in storage, including the header
+   *   bits 16-30  payload length (0 for padding records)
+   *   bit     31  committed
+   *
+   * Records are 4-byte aligned and never wrap around the end of storage.
+   * If a record doesn't fit before the end, the rest of the storage is
+   * claimed as a padding record, so the consumer can hand each payload
+   * to save() as a single contiguous run.
+   *
+   * Space is reused only after the consumer has zeroed it, so a header
+   * reads as uncommitted until its producer commits it. The usable
+   * capacity is the largest power of two that fits in the aligned storage.
+   */
+  class LogRing {
+    enum : uint32_t {
+      HEADER_SIZE = sizeof(uint32_t),
+      SIZE_MASK   = 0x0000ffff,
+      LENGTH_SHIFT = 16,
+      LENGTH_MASK = 0x7fff,
+      COMMITTED   = 0x80000000
+    };
+
+    char *storage;
+    uint32_t capacity, mask;
+    std::atomic<uint32_t> head, tail; // free-running byte offsets
+    uint32_t current_size;            // consumer only
+
+    std::atomic<uint32_t> &header(uint32_t offset) const {
+      return *(std::atomic<uint32_t> *) (storage + (offset & mask));
+    }
+
+    void release(uint32_t size);
+
+  public:
+    LogRing(void *storage, size_t len);
+
+    size_t size() const {return capacity;}
+    size_t max_record() const;
+
+    // producer side, safe from any thread
+    char *claim(size_t len);
+    void commit(char *record, size_t len);
+    bool write(const char *bytes, size_t len);
+
+    // consumer side, single thread (or externally serialized)
+    const char *peek(size_t &len);
+    void consume();
+    void flush();
+    bool empty() const;
+  };
+};
@@ -1,25 +1,225 @@
 // -*- Mode:C++ -*-
 #pragma once
 
+#include <limits>
+#include <stdint.h>
+
+/**
+ * @file    math.h
+ * @brief   Integer and fixed-point math for per-sample sensor work
+ *
+ * @details Everything here is integer only, apart from Fixed's conversions
+ *          to and from float, so it runs at the same speed in interrupt
+ *          handlers and threads and needs no FPU context.
+ *          Square roots are seeded from the position of the leading one
+ *          bit (CLZ on Cortex-M3/M4) and refined with Newton's method.
+ *          Vector helpers take anything with x, y and z members, e.g.,
+ *          the accelerometer's xyz_t.
+ */
+
 namespace akt {
-  inline unsigned short isqrt(unsigned long a) {
-    unsigned long rem = 0;
-    unsigned int root = 0;
-    int i;
-
-    for (i = 0; i < 16; i++) {
-      root <<= 1;
-      rem <<= 2;
-      rem += a >> 30;
-      a <<= 2;
-
-      if (root < rem) {
-        root++;
-        rem -= root;
-        root++;
+  // clamps a wider intermediate result to Rep (SSAT on Cortex-M4)
+  template<class Rep, class Wide> inline Rep saturate(Wide x) {
+    if (x > (Wide) std::numeric_limits<Rep>::max()) return std::numeric_limits<Rep>::max();
+    if (x < (Wide) std::numeric_limits<Rep>::min()) return std::numeric_limits<Rep>::min();
+    return (Rep) x;
+  }
+
+  /**
+   * A signed fixed-point number with Frac fraction bits stored in Rep.
+   * Arithmetic is done in Wide and saturates instead of wrapping, and
+   * products and quotients are rounded to nearest.
+   */
+  template<class Rep, class Wide, int Frac>
+  class Fixed {
+    Rep value;
+
+    struct Raw {};
+    Fixed(Rep r, Raw) : value(r) {}
+
+  public:
+    enum {FRACTION_BITS = Frac};
+    static const Wide ONE = (Wide) 1 << Frac;
+
+    Fixed() : value(0) {}
+
+    explicit Fixed(int x) : value(saturate<Rep>((int64_t) x * ONE)) {}
+
+    explicit Fixed(float x) {
+      float scaled = x * ONE;
+
+      if (scaled >= std::numeric_limits<Rep>::max()) {
+        value = std::numeric_limits<Rep>::max();
+      } else if (scaled <= std::numeric_limits<Rep>::min()) {
+        value = std::numeric_limits<Rep>::min();
+      } else {
+        value = (Rep) (scaled + (scaled < 0 ? -0.5f : 0.5f));
       }
     }
 
-    return (unsigned short) (root >> 1);
+    static Fixed from_raw(Rep r) {return Fixed(r, Raw());}
+    static Fixed max() {return from_raw(std::numeric_limits<Rep>::max());}
+    static Fixed min() {return from_raw(std::numeric_limits<Rep>::min());}
+
+    Rep raw() const {return value;}
+    float to_float() const {return (float) value / ONE;}
+
+    Fixed operator+(Fixed b) const {return from_raw(saturate<Rep>((Wide) value + b.value));}
+    Fixed operator-(Fixed b) const {return from_raw(saturate<Rep>((Wide) value - b.value));}
+    Fixed operator-() const {return from_raw(saturate<Rep>(-(Wide) value));}
+
+    Fixed operator*(Fixed b) const {
+      Wide product = (Wide) value * b.value;
+      return from_raw(saturate<Rep>((product + (ONE >> 1)) >> Frac));
+    }
+
+    // division by zero saturates towards the sign of the dividend
+    Fixed operator/(Fixed b) const {
+      if (b.value == 0) return value < 0 ? min() : max();
+
+      Wide n = (Wide) value * ONE, d = b.value;
+      Wide half = (d < 0 ? -d : d) / 2;
+      return from_raw(saturate<Rep>((n + (n < 0 ? -half : half)) / d));
+    }
+
+    Fixed &operator+=(Fixed b) {return *this = *this + b;}
+    Fixed &operator-=(Fixed b) {return *this = *this - b;}
+    Fixed &operator*=(Fixed b) {return *this = *this * b;}
+    Fixed &operator/=(Fixed b) {return *this = *this / b;}
+
+    bool operator==(Fixed b) const {return value == b.value;}
+    bool operator!=(Fixed b) const {return value != b.value;}
+    bool operator< (Fixed b) const {return value <  b.value;}
+    bool operator> (Fixed b) const {return value >  b.value;}
+    bool operator<=(Fixed b) const {return value <= b.value;}
+    bool operator>=(Fixed b) const {return value >= b.value;}
+  };
+
+  typedef Fixed<int16_t, int32_t, 15> Q15;       // [-1, 1)
+  typedef Fixed<int32_t, int64_t, 16> Q16_16;    // [-32768, 32768)
+
+  // floor(sqrt(a))
+  inline uint16_t isqrt(uint32_t a) {
+    if (a == 0) return 0;
+
+    // 2^ceil(bits/2) is at least the root, and Newton's method decreases
+    // monotonically from above, stopping at the floor
+    unsigned bits = 32 - __builtin_clz(a);
+    uint32_t x = (uint32_t) 1 << ((bits + 1) / 2);
+    uint32_t y = (x + a / x) / 2;
+
+    while (y < x) {
+      x = y;
+      y = (x + a / x) / 2;
+    }
+
+    return (uint16_t) x;
+  }
+
+  /**
+   * 2^31/sqrt(a), rounded, i.e., 1/sqrt(a) with 31 fraction bits. Zero
+   * gives the largest value. The input is normalized to [1, 4) by an
+   * even shift, a table gives the first 4 bits and three Newton steps for
+   * y*(3 - u*y^2)/2 do the rest without dividing.
+   */
+  inline uint32_t rsqrt(uint32_t a) {
+    // 1/sqrt(u) at the middle of each sixteenth of [1, 4), in Q2.30
+    static const uint32_t seeds[16] = {
+      1026693558, 948599586, 885984104, 834328203, 790767575, 753387102,
+      720851298, 692196655, 666708225, 643842818, 623179354, 604385689,
+      587195840, 571393950, 556802759, 543275165
+    };
+
+    if (a == 0) return 0xffffffff;
+
+    unsigned shift = __builtin_clz(a) & ~1u;
+    uint32_t m = a << shift;                             // u in Q2.30, [1, 4)
+    uint64_t y = seeds[(m - (1u << 30)) / (3u << 26)];  // Q2.30
+
+    for (int i=0; i < 3; ++i) {
+      uint64_t y2 = (y * y + (1u << 29)) >> 30;
+      uint64_t uy2 = (m * y2 + (1u << 29)) >> 30;
+      y = (y * ((3ull << 30) - uy2) + (1u << 30)) >> 31;
+    }
+
+    // 2^31/sqrt(a) = (1/sqrt(u)) * 2^(16 + shift/2)
+    int exponent = 16 + (int) shift/2 - 30;
+    uint64_t r = exponent >= 0 ? y << exponent : (y + (1ull << (-exponent - 1))) >> -exponent;
+    return r > 0xffffffff ? 0xffffffff : (uint32_t) r;
+  }
+
+  // 1/sqrt(x), saturating for x <= 0
+  inline Q16_16 rsqrt(Q16_16 x) {
+    if (x.raw() <= 0) return Q16_16::max();
+
+    // 1/sqrt(raw/2^16) in Q16.16 is 2^24/sqrt(raw)
+    uint32_t r = (rsqrt((uint32_t) x.raw()) + (1u << 6)) >> 7;
+    return Q16_16::from_raw(saturate<int32_t>((int64_t) r));
+  }
+
+  /**
+   * The angle of (x, y) as a fraction of pi, i.e., binary angle units where
+   * Q15 -1.0 is -pi and 0.5 is pi/2. The octant is found from the signs and
+   * the larger magnitude, and atan of the ratio from a 9th order odd
+   * polynomial (Abramowitz and Stegun 4.4.49), good to about 1e-5 rad,
+   * which is well under the 1e-4 rad resolution of the result.
+   */
+  inline Q15 atan2(int32_t y, int32_t x) {
+    // atan(r)/pi for r in [0, 1], coefficients in Q2.30 of r, r^3, ... r^9
+    static const int32_t c[5] = {
+      341736839, -112890634, 61569066, -29096981, 7121075
+    };
+
+    if (x == 0 && y == 0) return Q15();
+
+    uint32_t ax = x < 0 ? -(uint32_t) x : x, ay = y < 0 ? -(uint32_t) y : y;
+    bool steep = ay > ax;
+    uint32_t big = steep ? ay : ax, small = steep ? ax : ay;
+
+    int64_t r = ((uint64_t) small << 30) / big;   // Q2.30, [0, 1]
+    int64_t r2 = (r * r) >> 30;
+    int64_t p = c[4];
+    for (int i=3; i >= 0; --i) p = c[i] + ((p * r2) >> 30);
+    int32_t angle = (int32_t) ((p * r) >> 30);      // [0, 1/4] in Q2.30
+
+    if (steep) angle = (1 << 29) - angle;           // pi/2 - angle
+    if (x < 0) angle = (1 << 30) - angle;           // pi - angle
+    if (y < 0) angle = -angle;
+
+    // Q2.30 to Q15, with pi (1.0) wrapping to -pi
+    return Q15::from_raw((int16_t) (uint16_t) ((angle + (1 << 14)) >> 15));
+  }
+
+  inline uint16_t magnitude(int16_t x, int16_t y) {
+    return isqrt((uint32_t) ((int32_t) x*x) + (uint32_t) ((int32_t) y*y));
+  }
+
+  inline uint16_t magnitude(int16_t x, int16_t y, int16_t z) {
+    return isqrt((uint32_t) ((int32_t) x*x) + (uint32_t) ((int32_t) y*y) + (uint32_t) ((int32_t) z*z));
+  }
+
+  template<class V> inline uint16_t magnitude(const V &v) {
+    return magnitude(v.x, v.y, v.z);
+  }
+
+  /**
+   * Scales v to unit length with Q15 components, e.g., to get the
+   * direction of gravity from an accelerometer sample. A component that
+   * would be exactly 1.0 saturates to the largest Q15. The zero vector is
+   * left alone.
+   */
+  template<class V> inline void normalize(const V &v, Q15 &x, Q15 &y, Q15 &z) {
+    uint32_t s = (uint32_t) ((int32_t) v.x*v.x) + (uint32_t) ((int32_t) v.y*v.y) + (uint32_t) ((int32_t) v.z*v.z);
+
+    if (s == 0) {
+      x = y = z = Q15();
+      return;
+    }
+
+    // v/|v| in Q15 is v * 2^31/|v| / 2^16
+    int64_t r = rsqrt(s);
+    x = Q15::from_raw(saturate<int16_t>((v.x * r + (1 << 15)) >> 16));
+    y = Q15::from_raw(saturate<int16_t>((v.y * r + (1 << 15)) >> 16));
+    z = Q15::from_raw(saturate<int16_t>((v.z * r + (1 << 15)) >> 16));
   }
 };
@@ -0,0 +1,204 @@
+// -*- Mode:C++ -*-
+
+#pragma once
+
+/**
+ * @file    mirrored_ringbuffer.h
+ * @brief   Ring buffer whose storage is mapped twice, back to back (host only)
+ *
+ * @details MirroredRingBuffer has the same interface as the other ring buffers
+ *          in ringbuffer.h, but its storage is a memfd mapped at two adjacent
+ *          virtual addresses. Reading or writing past the end of the first
+ *          mapping lands at the start of the same physical pages, so every
+ *          read and write span is contiguous: contiguous_read_capacity()
+ *          always equals read_capacity(), and peek_read()/reserve_write()
+ *          never return a second span. Consumers such as json::Reader::read()
+ *          can be handed the whole readable region in one call.
+ *
+ *          The capacity is rounded up to a power-of-two multiple of the page
+ *          size and, as in StaticRingBuffer, free-running indices let the
+ *          buffer hold all of its elements.
+ *
+ *          This relies on memfd_create() and mmap(), so it's only available
+ *          on Linux hosts, e.g., for tools that reuse libakt code.
+ */
+
+#if defined(__linux__)
+
+#include "akt/ringbuffer.h"
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace akt {
+  template<class T> class MirroredRingBuffer {
+    T *storage;
+    size_t capacity, mask;
+    size_t write_index, read_index;
+
+    MirroredRingBuffer(const MirroredRingBuffer &);
+    MirroredRingBuffer &operator=(const MirroredRingBuffer &);
+
+    T *at(size_t index) const { return storage + (index & mask); }
+
+  public:
+    MirroredRingBuffer() :
+      storage(0),
+      capacity(0),
+      mask(0),
+      write_index(0),
+      read_index(0)
+    {}
+
+    ~MirroredRingBuffer() {
+      release();
+    }
+
+    /**
+     * @brief Maps storage for at least min_capacity elements
+     * @returns false if the mapping couldn't be created
+     */
+    bool allocate(size_t min_capacity) {
+      size_t bytes = (size_t) sysconf(_SC_PAGESIZE);
+
+      release();
+
+      // fail rather than wrap around, and keep both mappings addressable
+      if (min_capacity > SIZE_MAX / 4 / sizeof(T)) return false;
+      while (bytes < min_capacity * sizeof(T)) {
+        if (bytes > SIZE_MAX / 4) return false;
+        bytes *= 2;
+      }
+      if (bytes % sizeof(T) != 0) return false;
+
+      int fd = memfd_create("akt::MirroredRingBuffer", MFD_CLOEXEC);
+      if (fd < 0) return false;
+
+      if (ftruncate(fd, (off_t) bytes) != 0) {
+        close(fd);
+        return false;
+      }
+
+      // reserve twice the address space, then map the file into both halves
+      uint8_t *base = (uint8_t *) mmap(0, 2*bytes, PROT_NONE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+      if (base != MAP_FAILED) {
+        void *lower = mmap(base, bytes, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_FIXED, fd, 0);
+        void *upper = mmap(base + bytes, bytes, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_FIXED, fd, 0);
+
+        if (lower == MAP_FAILED || upper == MAP_FAILED) {
+          munmap(base, 2*bytes);
+          base = (uint8_t *) MAP_FAILED;
+        }
+      }
+
+      close(fd); // the mappings keep the file alive
+      if (base == MAP_FAILED) return false;
+
+      storage = (T *) base;
+      capacity = bytes / sizeof(T);
+      mask = capacity - 1;
+      flush();
+
+      return true;
+    }
+
+    void release() {
+      if (storage != 0) {
+        munmap(storage, 2 * capacity * sizeof(T));
+        storage = 0;
+        capacity = mask = 0;
+      }
+    }
+
+    bool allocated() const { return storage != 0; }
+    size_t size() const { return capacity; }
+
+    void flush() {
+      write_index = read_index = 0;
+    }
+
+    size_t read_capacity() const {
+      return write_index - read_index;
+    }
+
+    size_t contiguous_read_capacity() const {
+      return read_capacity();
+    }
+
+    size_t write_capacity() const {
+      return capacity - read_capacity();
+    }
+
+    size_t read(T *dst, size_t n) {
+      if (n > read_capacity()) n = read_capacity();
+
+      copy_run(dst, at(read_index), n);
+      read_index += n;
+
+      return n;
+    }
+
+    size_t write(const T *src, size_t n) {
+      if (n > write_capacity()) n = write_capacity();
+
+      copy_run(at(write_index), src, n);
+      write_index += n;
+
+      return n;
+    }
+
+    inline T &peek(int offset) const {
+      return *at(read_index + offset);
+    }
+
+    inline T &poke(int offset) const {
+      return *at(write_index + offset);
+    }
+
+    void skip(size_t offset) {
+      size_t cap = read_capacity();
+
+      if (offset > cap) offset = cap;
+      read_index += offset;
+    }
+
+    RingSpans<T> reserve_write(size_t n) {
+      RingSpans<T> spans;
+
+      spans.first.data = at(write_index);
+      spans.first.length = (n < write_capacity()) ? n : write_capacity();
+      spans.second.data = storage;
+      spans.second.length = 0;
+
+      return spans;
+    }
+
+    void commit_write(size_t n) {
+      assert(n <= write_capacity());
+      write_index += n;
+    }
+
+    RingSpans<T> peek_read() const {
+      RingSpans<T> spans;
+
+      spans.first.data = at(read_index);
+      spans.first.length = read_capacity();
+      spans.second.data = storage;
+      spans.second.length = 0;
+
+      return spans;
+    }
+
+    void consume(size_t n) {
+      assert(n <= read_capacity());
+      read_index += n;
+    }
+  };
+};
+
+#endif
@@ -0,0 +1,155 @@
+// -*- Mode:C++ -*-
+
+#pragma once
+
+#include "akt/assert.h"
+#include "akt/ring.h"
+
+#include <atomic>
+
+namespace akt {
+  /**
+   * MPSCQueue is an intrusive, lock-free, multi-producer/single-consumer FIFO
+   * of Ring<T> elements, after Dmitry Vyukov's non-intrusive MPSC node queue.
+   * It reuses the link fields of RingBase, so anything that can live in a
+   * Ring<T> (e.g., a bluetooth::Packet) can be queued without extra storage.
+   *
+   * push() is a single atomic exchange plus a store, so it may be called from
+   * any number of threads and interrupt handlers at once. pop() must only be
+   * called by one consumer at a time.
+   *
+   * While an element is in the queue, its right link is the "next" pointer
+   * and its left link is zero, so it must not be in any Ring when pushed.
+   * pop() turns the element back into a singleton ring.
+   *
+   * The consumer can also be whichever thread holds a busy flag, e.g., the
+   * H4 transmitter, where a sender starts the UART if it's idle and the
+   * transfer complete interrupt takes the next packet. push_and_claim()
+   * and pop_or_release() hand the flag over without losing an element
+   * that's pushed while it's being given up.
+   */
+  template<class T> class MPSCQueue {
+    RingBase stub;
+    RingBase *head; // most recently pushed, updated by producers
+    RingBase *tail; // next to be popped, only changed by the consumer
+
+    static RingBase *next(const RingBase *node) {
+      return __atomic_load_n(&node->right, __ATOMIC_ACQUIRE);
+    }
+
+    void set_tail(RingBase *t) {__atomic_store_n(&tail, t, __ATOMIC_RELAXED);}
+
+    void enqueue(RingBase *node) {
+      link(swap_head(node), node);
+    }
+
+  protected:
+    // the two halves of a push, apart so tests can interleave them
+    RingBase *swap_head(RingBase *node) {
+      node->left = 0;
+      __atomic_store_n(&node->right, (RingBase *) 0, __ATOMIC_RELAXED);
+
+      return __atomic_exchange_n(&head, node, __ATOMIC_ACQ_REL);
+    }
+
+    // Between the exchange and this store the chain is broken, and the
+    // consumer will see the queue as empty past prev until it's linked.
+    void link(RingBase *prev, RingBase *node) {
+      __atomic_store_n(&prev->right, node, __ATOMIC_RELEASE);
+    }
+
+  public:
+    MPSCQueue() {reset();}
+
+    // only safe while no producer or consumer is active
+    void reset() {
+      stub.left = stub.right = 0;
+      head = tail = &stub;
+    }
+
+    void push(T *element) {
+      RingBase *node = (Ring<T> *) element;
+
+      assert(node->left == node); // must be a singleton, i.e., in no ring
+      enqueue(node);
+    }
+
+    T *pop() {
+      RingBase *t = tail;
+      RingBase *n = next(t);
+
+      if (t == &stub) {
+        if (n == 0) return 0; // empty
+        set_tail(t = n);
+        n = next(n);
+      }
+
+      if (n == 0) {
+        // t is the last linked element. It can only be taken once something
+        // follows it, so put the stub back behind it unless a producer is
+        // already in the middle of pushing after it.
+        if (t != __atomic_load_n(&head, __ATOMIC_ACQUIRE)) return 0;
+
+        enqueue(&stub);
+        n = next(t);
+        if (n == 0) return 0;
+      }
+
+      set_tail(n);
+      t->left = t->right = t; // back to a singleton ring
+      return (T *) (Ring<T> *) t;
+    }
+
+    bool empty() const {
+      return tail == &stub && next(&stub) == 0;
+    }
+
+    /**
+     * Whether pop() would return an element rather than wait for a push
+     * that's still in progress. Any thread may ask, but the answer is only
+     * a hint unless the caller is the consumer.
+     */
+    bool ready() const {
+      const RingBase *t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+      const RingBase *n = next(t);
+
+      if (t == &stub) {
+        if (n == 0) return false;
+        t = n;
+        n = next(n);
+      }
+
+      return n != 0 || t == __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    }
+
+    // Pushes element, then becomes the consumer if busy was clear and
+    // returns the first element, or returns 0 if someone else is busy.
+    T *push_and_claim(T *element, std::atomic<bool> &busy) {
+      push(element);
+      return busy.exchange(true) ? 0 : pop_or_release(busy);
+    }
+
+    // for the consumer holding busy: the next element, or 0 and busy clear
+    T *pop_or_release(std::atomic<bool> &busy) {
+      T *e = pop();
+      return e ? e : release(busy);
+    }
+
+    /**
+     * Clears busy for a consumer that found nothing to pop. A producer may
+     * have linked an element after that pop and then found busy still set,
+     * leaving the element to this consumer, so the queue is checked again
+     * afterwards and busy retaken if needed. A push still in progress
+     * doesn't count as ready, since its producer will find busy clear.
+     */
+    T *release(std::atomic<bool> &busy) {
+      for (;;) {
+        busy.store(false);
+        if (!ready() || busy.exchange(true)) return 0;
+
+        T *e = pop();
+        if (e) return e;
+      }
+    }
+  };
+};
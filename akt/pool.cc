@@ -0,0 +1,22 @@
+#include "akt/pool.h"
+
+using namespace akt;
+
+Ring<PoolStats> PoolStats::registry __attribute__ ((init_priority(200)));
+
+PoolStats::PoolStats(const char *name, uint32_t capacity, uint32_t object_size) :
+  Ring(),
+  used(0),
+  peak(0),
+  allocs(0),
+  fails(0),
+  name(name ? name : "(unnamed)"),
+  capacity(capacity),
+  object_size(object_size)
+{
+  join(registry);
+}
+
+PoolStats::~PoolStats() {
+  join(this); // leave the registry
+}
@@ -5,22 +5,78 @@
 #include "akt/assert.h"
 #include "akt/ring.h"
 
+#include <atomic>
 #include <stdint.h>
 
 namespace akt {
+  /**
+   * Objects that have to find their own way back to the pool they came from
+   * (e.g., bluetooth::Packet) keep a pointer to a Deallocator, which lets
+   * them be released without knowing the concrete pool type.
+   */
+  template<class T> class Deallocator {
+  public:
+    virtual void deallocate(T *p) = 0;
+  };
+
+  /**
+   * Every pool keeps a PoolStats instance, which tracks how many objects are
+   * in use, the high-water mark of that number, and how many allocations
+   * succeeded or failed. All instances are kept on a global list so they can
+   * be inspected at run time (e.g., by the "pools" shell command) to size
+   * pools from real data. The counters are relaxed atomics, so they're safe
+   * to update from ISRs and cost a few cycles per operation.
+   */
+  class PoolStats : public Ring<PoolStats> {
+    std::atomic<uint32_t> used, peak, allocs, fails;
+
+  public:
+    const char *const name;
+    const uint32_t capacity, object_size;
+
+    PoolStats(const char *name, uint32_t capacity, uint32_t object_size);
+    ~PoolStats();
+
+    void allocated() {
+      uint32_t n = used.fetch_add(1, std::memory_order_relaxed) + 1;
+      uint32_t p = peak.load(std::memory_order_relaxed);
+
+      while (n > p && !peak.compare_exchange_weak(p, n, std::memory_order_relaxed)) {}
+      allocs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void failed() {fails.fetch_add(1, std::memory_order_relaxed);}
+    void freed() {used.fetch_sub(1, std::memory_order_relaxed);}
+    void reset() {used.store(0, std::memory_order_relaxed);}
+
+    uint32_t in_use() const {return used.load(std::memory_order_relaxed);}
+    uint32_t peak_in_use() const {return peak.load(std::memory_order_relaxed);}
+    uint32_t min_free() const {return capacity - peak_in_use();}
+    uint32_t allocations() const {return allocs.load(std::memory_order_relaxed);}
+    uint32_t failures() const {return fails.load(std::memory_order_relaxed);}
+
+    static Ring<PoolStats> registry; /// list of all pools' stats
+  };
+
   template<class T> class PoolBase {
   public:
     Ring<T> available;
     const uint32_t capacity;
+    PoolStats stats;
 
-    PoolBase(uint32_t cap) : capacity(cap) {}
+    PoolBase(uint32_t cap, const char *name = 0) : capacity(cap), stats(name, cap, sizeof(T)) {}
 
     T *allocate() {
       T *p = available.begin();
-      if (p == available.end()) return 0;
+
+      if (p == available.end()) {
+        stats.failed();
+        return 0;
+      }
 
       p->join(p);
       p->reset();
+      stats.allocated();
 
       return p;
     }
@@ -28,6 +84,7 @@ namespace akt {
     void deallocate(T *p) {
       assert(p != 0);
       ((Ring<T> *) p)->join(&available);
+      stats.freed();
     }
   };
 
@@ -36,8 +93,8 @@ namespace akt {
     T pool[S];
 
   public:
-    Pool() :
-      PoolBase<T>(S) {
+    Pool(const char *name = 0) :
+      PoolBase<T>(S, name) {
       reset();
     }
 
@@ -46,6 +103,180 @@ namespace akt {
         Ring<T> *p = (Ring<T> *) (pool + i);
         p->join(&this->available);
       }
+
+      this->stats.reset();
+    }
+  };
+
+  /**
+   * LockFreePool has the same allocate()/deallocate() interface as Pool, but
+   * both operations are lock-free and may be called from any thread or
+   * interrupt handler at the same time.
+   *
+   * Free objects form a singly linked list of 16-bit indices kept outside the
+   * objects. The list head packs the index of the first free object together
+   * with a 16-bit tag that is bumped on every change, so a single 32-bit
+   * compare-and-swap (LDREX/STREX on Cortex-M) updates it. The tag makes the
+   * classic ABA problem require 65536 pool operations to happen while one
+   * caller is preempted in the middle of its own.
+   */
+  template<class T, unsigned int S> class LockFreePool {
+    static_assert(S < 0xffff, "too many objects for 16-bit indices");
+
+    enum : uint32_t {
+      NIL = 0xffff,
+      INDEX_MASK = 0x0000ffff,
+      TAG_ONE = 0x00010000
+    };
+
+    std::atomic<uint32_t> head; // (tag << 16) | index of first free object
+    std::atomic<uint16_t> next[S];
+
+  protected:
+    T pool[S];
+
+  public:
+    const uint32_t capacity;
+    PoolStats stats;
+
+    LockFreePool(const char *name = 0) : capacity(S), stats(name, S, sizeof(T)) {
+      reset();
+    }
+
+    // not thread safe; every object must be free (or abandoned)
+    void reset() {
+      for (unsigned int i=0; i < S; ++i) {
+        next[i].store((i+1 < S) ? i+1 : NIL, std::memory_order_relaxed);
+      }
+
+      head.store(0, std::memory_order_release);
+      stats.reset();
+    }
+
+    bool owns(const T *p) const {
+      return p >= pool && p < pool + S;
+    }
+
+    T *allocate() {
+      T *p = try_allocate();
+
+      if (p == 0) stats.failed();
+      return p;
+    }
+
+    // same as allocate(), but running out isn't counted as a failure, e.g.,
+    // when the caller has somewhere else to look
+    T *try_allocate() {
+      uint32_t old = head.load(std::memory_order_acquire), desired;
+
+      do {
+        uint32_t i = old & INDEX_MASK;
+
+        if (i == NIL) return 0;
+
+        // next[i] may be stale if i was taken meanwhile, but then the tag
+        // has changed too and the exchange fails
+        desired = ((old + TAG_ONE) & ~INDEX_MASK) | next[i].load(std::memory_order_relaxed);
+      } while (!head.compare_exchange_weak(old, desired,
+                                           std::memory_order_acquire,
+                                           std::memory_order_acquire));
+
+      T *p = pool + (old & INDEX_MASK);
+      p->reset();
+      stats.allocated();
+
+      return p;
+    }
+
+    void deallocate(T *p) {
+      assert(owns(p));
+
+      uint32_t i = (uint32_t) (p - pool);
+      uint32_t old = head.load(std::memory_order_relaxed), desired;
+
+      do {
+        next[i].store(old & INDEX_MASK, std::memory_order_relaxed);
+        desired = ((old + TAG_ONE) & ~INDEX_MASK) | i;
+      } while (!head.compare_exchange_weak(old, desired,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+
+      stats.freed();
+    }
+  };
+
+  /**
+   * BitmapPool has the same interface as Pool, but keeps track of the free
+   * objects in an occupancy bitmap instead of threading a list through
+   * them. A summary word has a bit for each bitmap word with a free object
+   * in it, so allocate() finds the free object with the lowest address in
+   * constant time with two count-trailing-zeros (RBIT+CLZ on Cortex-M),
+   * for up to 1024 objects. reset() clears a few words instead of touching
+   * every object, and owns() and allocated() are O(1), which lets
+   * deallocate() catch double frees and foreign pointers. T doesn't have to
+   * be a Ring. Like Pool, it isn't thread safe.
+   */
+  template<class T, unsigned int S> class BitmapPool {
+    enum {WORDS = (S + 31) / 32};
+    static_assert(S > 0 && WORDS <= 32, "between 1 and 1024 objects");
+
+    uint32_t free_bits[WORDS]; // a set bit means the object is free
+    uint32_t free_words;       // a set bit means free_bits[w] != 0
+
+  protected:
+    T pool[S];
+
+  public:
+    const uint32_t capacity;
+    PoolStats stats;
+
+    BitmapPool(const char *name = 0) : capacity(S), stats(name, S, sizeof(T)) {
+      reset();
+    }
+
+    void reset() {
+      for (unsigned int w=0; w < WORDS; ++w) free_bits[w] = 0xffffffff;
+      if (S % 32) free_bits[WORDS-1] = (1u << (S % 32)) - 1;
+      free_words = (uint32_t) ((1ull << WORDS) - 1);
+      stats.reset();
+    }
+
+    bool owns(const T *p) const {
+      return p >= pool && p < pool + S;
+    }
+
+    bool allocated(const T *p) const {
+      if (!owns(p)) return false;
+
+      unsigned int i = p - pool;
+      return (free_bits[i / 32] & (1u << (i % 32))) == 0;
+    }
+
+    T *allocate() {
+      if (free_words == 0) {
+        stats.failed();
+        return 0;
+      }
+
+      unsigned int w = __builtin_ctz(free_words);
+      unsigned int bit = __builtin_ctz(free_bits[w]);
+      T *p = pool + 32*w + bit;
+
+      free_bits[w] &= ~(1u << bit);
+      if (free_bits[w] == 0) free_words &= ~(1u << w);
+      p->reset();
+      stats.allocated();
+
+      return p;
+    }
+
+    void deallocate(T *p) {
+      assert(allocated(p)); // not from this pool, or freed twice
+
+      unsigned int i = p - pool;
+      free_bits[i / 32] |= 1u << (i % 32);
+      free_words |= 1u << (i / 32);
+      stats.freed();
     }
   };
 };
@@ -3,7 +3,11 @@
 #pragma once
 
 namespace akt {
+  template<class T> class MPSCQueue;
+
   class RingBase {
+    template<class T> friend class MPSCQueue;
+
   protected:
     RingBase *left;
     RingBase *right;
@@ -5,10 +5,40 @@
 #include <cstdlib>
 #include <stdint.h>
 #include <cstddef>
+#include <atomic>
+#include <algorithm>
 
 #include "akt/assert.h"
 
 namespace akt {
+  /**
+   * The readable or writable region of a ring buffer occupies at most two
+   * contiguous runs of storage: one that ends at the physical end of the
+   * storage and one that continues from the beginning.
+   */
+  template<class T> struct RingSpans {
+    struct {
+      T *data;
+      size_t length;
+    } first, second;
+
+    size_t length() const { return first.length + second.length; }
+  };
+
+  /*
+   * Copies one contiguous run of elements. For trivially copyable T,
+   * std::copy is lowered to a single memmove, which is far cheaper than an
+   * element loop for anything but the shortest runs. Other types still get
+   * a loop with proper assignment semantics.
+   */
+  template<class T> inline void copy_run(T *dst, const T *src, size_t n) {
+    if (n < 8) {
+      for (size_t i=0; i < n; ++i) dst[i] = src[i];
+    } else {
+      std::copy(src, src + n, dst);
+    }
+  }
+
   template<class T> class RingBuffer {
     T *const storage, *const limit;
     T *write_position, *read_position;
@@ -64,7 +94,9 @@ namespace akt {
         if (run == 0) break;
         if (n < run) run = n;
 
-        for(uint32_t i=run; i > 0; --i) *dst++ = *read_position++;
+        copy_run(dst, read_position, run);
+        dst += run;
+        read_position += run;
         if (read_position == limit) read_position = storage;
 
         n -= run;
@@ -79,7 +111,7 @@ namespace akt {
       assert(abs(offset) < capacity);
       T *p = read_position + offset;
       if (p < storage) p += capacity;
-      if (p > limit) p -= capacity;
+      if (p >= limit) p -= capacity;
       return *p;
     }
 
@@ -97,7 +129,7 @@ namespace akt {
       assert(abs(offset) < capacity);
       if (offset < 0) offset += capacity;
       T *p = write_position + offset;
-      if (p > limit) p -= capacity;
+      if (p >= limit) p -= capacity;
       if (p < storage) p += capacity;
       return *p;
     }
@@ -110,6 +142,7 @@ namespace akt {
 
         if (write_position >= read_position) {
           run = limit - write_position;
+          if (read_position == storage) run -= 1; // never catch up to the reader
         } else {
           run = (read_position - write_position) - 1;
         }
@@ -117,7 +150,9 @@ namespace akt {
         if (run == 0) break;
         if (n < run) run = n;
 
-        for (uint32_t i=run; i > 0; --i) *write_position++ = *src++;
+        copy_run(write_position, src, run);
+        src += run;
+        write_position += run;
         if (write_position == limit) write_position = storage;
 
         n -= run;
@@ -126,5 +161,456 @@ namespace akt {
 
       return written;
     }
+
+    /*
+     * Flight recorder mode. Instead of refusing data when the buffer is full,
+     * overwrite() evicts the oldest elements so that the newest ones always
+     * fit. If n is larger than the buffer itself, only the last elements of
+     * src are kept. Returns the number of elements discarded, counting both
+     * evicted elements and any skipped part of src. Eviction is just a move
+     * of the read position, so the extra cost is O(1) per call.
+     *
+     * The overwriting methods move the read position, so they must not run
+     * concurrently with a reader.
+     */
+    size_t overwrite(const T *src, size_t n) {
+      const size_t max = (limit - storage) - 1;
+      size_t discarded = 0;
+
+      if (n > max) {
+        discarded = n - max;
+        src += discarded;
+        n = max;
+      }
+
+      size_t available = write_capacity();
+
+      if (n > available) {
+        skip(n - available);
+        discarded += n - available;
+      }
+
+      write(src, n);
+      return discarded;
+    }
+
+    /*
+     * Same as above, but evicts whole records so that the reader never sees
+     * a partial one. record_length(ring) must return the length of the
+     * oldest record in the buffer, which begins at peek(0). Each record is
+     * evicted at most once, so the cost is amortized O(1) per record. A
+     * record must be shorter than the buffer.
+     */
+    template<class F>
+    size_t overwrite(const T *src, size_t n, F record_length) {
+      size_t evicted = 0;
+
+      assert(n < (size_t) (limit - storage));
+
+      while (write_capacity() < n) {
+        size_t len = record_length(*this);
+
+        assert(len > 0);
+        skip(len);
+        evicted += len;
+      }
+
+      write(src, n);
+      return evicted;
+    }
+
+    /*
+     * Zero-copy access. reserve_write() returns up to n elements of free
+     * space directly inside the storage, which the caller fills in place
+     * (e.g., with vsnprintf or a DMA transfer) and then publishes with
+     * commit_write(). Likewise, peek_read() returns the readable elements
+     * in place, and consume() releases them once they've been used.
+     * Nothing is moved by reserve_write() or peek_read() themselves.
+     */
+    RingSpans<T> reserve_write(size_t n) {
+      RingSpans<T> spans;
+
+      spans.first.data = write_position;
+      spans.second.data = storage;
+
+      if (write_position >= read_position) {
+        spans.first.length = limit - write_position;
+        spans.second.length = read_position - storage;
+
+        // one slot always stays empty so that full and empty differ
+        if (spans.second.length > 0) {
+          spans.second.length -= 1;
+        } else {
+          spans.first.length -= 1;
+        }
+      } else {
+        spans.first.length = (read_position - write_position) - 1;
+        spans.second.length = 0;
+      }
+
+      if (n < spans.first.length) spans.first.length = n;
+      n -= spans.first.length;
+      if (n < spans.second.length) spans.second.length = n;
+
+      return spans;
+    }
+
+    void commit_write(size_t n) {
+      assert(n <= write_capacity());
+
+      write_position += n;
+      if (write_position >= limit) write_position -= (limit - storage);
+    }
+
+    RingSpans<T> peek_read() const {
+      RingSpans<T> spans;
+
+      spans.first.data = read_position;
+      spans.second.data = storage;
+
+      if (write_position >= read_position) {
+        spans.first.length = write_position - read_position;
+        spans.second.length = 0;
+      } else {
+        spans.first.length = limit - read_position;
+        spans.second.length = write_position - storage;
+      }
+
+      return spans;
+    }
+
+    void consume(size_t n) {
+      assert(n <= read_capacity());
+      skip(n);
+    }
+  };
+
+  /**
+   * StaticRingBuffer is a RingBuffer whose storage size N is a power of two
+   * known at compile time. The read and write indices run freely and are
+   * only masked with N-1 when storage is accessed, so full and empty are
+   * distinguished by the index difference alone. This removes the wraparound
+   * branches and lets the buffer hold all N elements instead of N-1.
+   */
+  template<class T, size_t N> class StaticRingBuffer {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+    enum : size_t {MASK = N - 1};
+
+    T storage[N];
+    size_t write_index, read_index;
+
+  public:
+    StaticRingBuffer() : write_index(0), read_index(0) {}
+
+    void flush() {
+      write_index = read_index = 0;
+    }
+
+    static size_t capacity() { return N; }
+
+    size_t read_capacity() const {
+      return write_index - read_index;
+    }
+
+    size_t contiguous_read_capacity() const {
+      size_t run = N - (read_index & MASK);
+      size_t n = read_capacity();
+      return (n < run) ? n : run;
+    }
+
+    size_t write_capacity() const {
+      return N - read_capacity();
+    }
+
+    size_t read(T *dst, size_t n) {
+      size_t available = read_capacity();
+      if (n > available) n = available;
+
+      RingSpans<T> s = spans(read_index, n);
+      copy_run(dst, s.first.data, s.first.length);
+      copy_run(dst + s.first.length, s.second.data, s.second.length);
+      read_index += n;
+
+      return n;
+    }
+
+    inline T &peek(int offset) {
+      return storage[(read_index + offset) & MASK];
+    }
+
+    void skip(size_t offset) {
+      size_t cap = read_capacity();
+
+      if (offset > cap) offset = cap;
+      read_index += offset;
+    }
+
+    inline T &poke(int offset) {
+      return storage[(write_index + offset) & MASK];
+    }
+
+    size_t write(const T *src, size_t n) {
+      size_t available = write_capacity();
+      if (n > available) n = available;
+
+      RingSpans<T> s = spans(write_index, n);
+      copy_run(s.first.data, src, s.first.length);
+      copy_run(s.second.data, src + s.first.length, s.second.length);
+      write_index += n;
+
+      return n;
+    }
+
+    // flight recorder mode, see RingBuffer::overwrite()
+    size_t overwrite(const T *src, size_t n) {
+      size_t discarded = 0;
+
+      if (n > N) {
+        discarded = n - N;
+        src += discarded;
+        n = N;
+      }
+
+      size_t available = write_capacity();
+
+      if (n > available) {
+        read_index += n - available;
+        discarded += n - available;
+      }
+
+      RingSpans<T> s = spans(write_index, n);
+      copy_run(s.first.data, src, s.first.length);
+      copy_run(s.second.data, src + s.first.length, s.second.length);
+      write_index += n;
+
+      return discarded;
+    }
+
+    template<class F>
+    size_t overwrite(const T *src, size_t n, F record_length) {
+      size_t evicted = 0;
+
+      assert(n <= N);
+
+      while (write_capacity() < n) {
+        size_t len = record_length(*this);
+
+        assert(len > 0);
+        skip(len);
+        evicted += len;
+      }
+
+      write(src, n);
+      return evicted;
+    }
+
+    bool put(const T &x) {
+      if (read_capacity() == N) return false;
+      storage[write_index++ & MASK] = x;
+      return true;
+    }
+
+    bool get(T &x) {
+      if (read_capacity() == 0) return false;
+      x = storage[read_index++ & MASK];
+      return true;
+    }
+
+    RingSpans<T> reserve_write(size_t n) {
+      return spans(write_index, (n < write_capacity()) ? n : write_capacity());
+    }
+
+    void commit_write(size_t n) {
+      assert(n <= write_capacity());
+      write_index += n;
+    }
+
+    RingSpans<T> peek_read() {
+      return spans(read_index, read_capacity());
+    }
+
+    void consume(size_t n) {
+      assert(n <= read_capacity());
+      read_index += n;
+    }
+
+  private:
+    RingSpans<T> spans(size_t index, size_t n) {
+      RingSpans<T> result;
+      size_t start = index & MASK;
+
+      // n <= N, so the wrapped length is the masked end, which also tells
+      // the compiler it's shorter than N
+      result.first.data = storage + start;
+      result.second.data = storage;
+      if (start + n <= N) {
+        result.first.length = n;
+        result.second.length = 0;
+      } else {
+        result.first.length = N - start;
+        result.second.length = (start + n) & MASK;
+      }
+
+      return result;
+    }
+  };
+
+  /**
+   * SPSCRingBuffer has the same interface and the same one-empty-slot layout
+   * as RingBuffer, but is safe to use without any locking as long as there
+   * is exactly one producer and one consumer. A typical producer is an
+   * interrupt handler (e.g., UART::rxchar) and a typical consumer is a thread.
+   *
+   * Only the producer may call write() and poke(). Only the consumer may call
+   * read(), peek() and skip(). Each side publishes its own index with release
+   * semantics and reads the other side's index with acquire semantics, so the
+   * element data is always visible before the index that covers it.
+   *
+   * flush() touches both indices and must only be called while neither side
+   * is active.
+   */
+  template<class T> class SPSCRingBuffer {
+    T *const storage;
+    const size_t capacity;
+    std::atomic<size_t> write_index, read_index;
+
+    size_t next(size_t index, size_t n) const {
+      index += n;
+      return (index >= capacity) ? index - capacity : index;
+    }
+
+  public:
+    SPSCRingBuffer(T *const s, size_t capacity) :
+      storage(s),
+      capacity(capacity),
+      write_index(0),
+      read_index(0)
+    {}
+
+    void flush() {
+      write_index.store(0, std::memory_order_relaxed);
+      read_index.store(0, std::memory_order_release);
+    }
+
+    size_t read_capacity() const {
+      size_t w = write_index.load(std::memory_order_acquire);
+      size_t r = read_index.load(std::memory_order_relaxed);
+
+      return (w >= r) ? w - r : (capacity - r) + w;
+    }
+
+    size_t contiguous_read_capacity() const {
+      size_t w = write_index.load(std::memory_order_acquire);
+      size_t r = read_index.load(std::memory_order_relaxed);
+
+      return (w >= r) ? w - r : capacity - r;
+    }
+
+    size_t write_capacity() const {
+      size_t w = write_index.load(std::memory_order_relaxed);
+      size_t r = read_index.load(std::memory_order_acquire);
+
+      return (w >= r) ? (capacity - 1) - (w - r) : (r - w) - 1;
+    }
+
+    size_t read(T *dst, size_t n) {
+      const size_t w = write_index.load(std::memory_order_acquire);
+      size_t r = read_index.load(std::memory_order_relaxed);
+      size_t actually_read = 0;
+
+      while (n > 0) {
+        size_t run = (w >= r) ? w - r : capacity - r;
+
+        if (run == 0) break;
+        if (n < run) run = n;
+
+        copy_run(dst, storage + r, run);
+        dst += run;
+        r = next(r, run);
+
+        n -= run;
+        actually_read += run;
+      }
+
+      read_index.store(r, std::memory_order_release);
+      return actually_read;
+    }
+
+    inline T &peek(int offset) const {
+      assert(abs(offset) < (ptrdiff_t) capacity);
+      ptrdiff_t i = (ptrdiff_t) read_index.load(std::memory_order_relaxed) + offset;
+      if (i < 0) i += capacity;
+      if (i >= (ptrdiff_t) capacity) i -= capacity;
+      return storage[i];
+    }
+
+    void skip(size_t offset) {
+      size_t cap = read_capacity();
+
+      if (offset > cap) offset = cap;
+
+      read_index.store(next(read_index.load(std::memory_order_relaxed), offset),
+                       std::memory_order_release);
+    }
+
+    inline T &poke(int offset) const {
+      assert(abs(offset) < (ptrdiff_t) capacity);
+      ptrdiff_t i = (ptrdiff_t) write_index.load(std::memory_order_relaxed) + offset;
+      if (i < 0) i += capacity;
+      if (i >= (ptrdiff_t) capacity) i -= capacity;
+      return storage[i];
+    }
+
+    size_t write(const T *src, size_t n) {
+      size_t w = write_index.load(std::memory_order_relaxed);
+      const size_t r = read_index.load(std::memory_order_acquire);
+      size_t written = 0;
+
+      while (n > 0) {
+        size_t run;
+
+        if (w >= r) {
+          run = capacity - w;
+          if (r == 0) run -= 1; // never let w catch up to r
+        } else {
+          run = (r - w) - 1;
+        }
+
+        if (run == 0) break;
+        if (n < run) run = n;
+
+        copy_run(storage + w, src, run);
+        src += run;
+        w = next(w, run);
+
+        n -= run;
+        written += run;
+      }
+
+      write_index.store(w, std::memory_order_release);
+      return written;
+    }
+
+    // single element versions for use from an ISR, e.g., UART::rxchar()
+    bool put(const T &x) {
+      size_t w = write_index.load(std::memory_order_relaxed);
+      size_t n = next(w, 1);
+
+      if (n == read_index.load(std::memory_order_acquire)) return false;
+
+      storage[w] = x;
+      write_index.store(n, std::memory_order_release);
+      return true;
+    }
+
+    bool get(T &x) {
+      size_t r = read_index.load(std::memory_order_relaxed);
+
+      if (r == write_index.load(std::memory_order_acquire)) return false;
+
+      x = storage[r];
+      read_index.store(next(r, 1), std::memory_order_release);
+      return true;
+    }
   };
 };
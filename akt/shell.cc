@@ -1,4 +1,5 @@
 #include "akt/shell.h"
+#include "akt/pool.h"
 #include "ch.h"
 #include "hal.h"
 #include "chprintf.h"
@@ -270,6 +271,28 @@ void MemoryCommand::exec(int argc, char *argv[]) {
   }
 }
 
+PoolsCommand::PoolsCommand() :
+  ShellCommand("pools")
+{
+}
+
+void PoolsCommand::exec(int argc, char *argv[]) {
+  if (argc == 0) {
+    chprintf(tty, "pools    -- object pool usage\r\n");
+  } else {
+    chprintf(tty, "%-20s %5s %4s %4s %4s %8s %8s %6s\r\n",
+             "name", "bytes", "size", "used", "peak", "min free", "allocs", "fails");
+
+    // list in order of construction
+    Ring<PoolStats> &pools = PoolStats::registry;
+    for (Ring<PoolStats>::Iterator i=pools.rbegin(); i != pools.end(); --i) {
+      chprintf(tty, "%-20s %5lu %4lu %4lu %4lu %8lu %8lu %6lu\r\n",
+               i->name, i->object_size, i->capacity, i->in_use(), i->peak_in_use(),
+               i->min_free(), i->allocations(), i->failures());
+    }
+  }
+}
+
 ResetCommand::ResetCommand() :
   ShellCommand("reset")
 {
@@ -160,6 +160,20 @@ namespace akt {
     void exec(int argc, char *argv[]) override;
   };
 
+  /**
+   * @brief Prints out usage statistics for every object pool
+   *
+   * Pools are listed in order of construction, one line each: the pool's
+   * name, its object size in bytes, its capacity, the objects in use now
+   * and at the peak, the fewest ever free (capacity - peak), and the
+   * number of allocations and of failed allocations.
+   */
+  class PoolsCommand : public ShellCommand {
+  public:
+    PoolsCommand();
+    void exec(int argc, char *argv[]) override;
+  };
+
   /**
    * @brief Forces a software reset of the system
    *
@@ -180,6 +194,7 @@ namespace akt {
     ThreadsCommand threads_command;
 #endif
     MemoryCommand memory_command;
+    PoolsCommand pools_command;
     ResetCommand reset_command;
   };
 };
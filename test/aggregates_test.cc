@@ -0,0 +1,451 @@
+#include <akt/aggregates.h>
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace akt;
+
+TEST(LogHistogramTest, TestLayout) {
+  typedef LogHistogram<1, 24> One;
+  typedef LogHistogram<2> Two;
+  typedef LogHistogram<3> Three;
+
+  EXPECT_EQ(5, One::SUB_BUCKET_BITS);
+  EXPECT_EQ(8, Two::SUB_BUCKET_BITS);
+  EXPECT_EQ(11, Three::SUB_BUCKET_BITS);
+  EXPECT_EQ((24 - 5 + 2) * 16, One::BUCKETS);
+  EXPECT_EQ(One::BUCKETS - 1, One::index_of(One::HIGHEST));
+  EXPECT_EQ(Two::BUCKETS - 1, Two::index_of(0xffffffff));
+}
+
+TEST(LogHistogramTest, TestSmallValuesAreExact) {
+  typedef LogHistogram<2> H;
+
+  for (uint32_t v=0; v < 256; ++v) {
+    EXPECT_EQ(v, H::index_of(v));
+    EXPECT_EQ(v, H::lowest_in(v));
+    EXPECT_EQ(v, H::highest_in(v));
+  }
+}
+
+// every value lands in a bucket that contains it, buckets are contiguous,
+// and each one is narrow enough for the promised number of digits
+template<class H> void check_buckets(double relative_error) {
+  for (unsigned i=1; i < H::BUCKETS; ++i) {
+    ASSERT_EQ(H::highest_in(i - 1) + 1, H::lowest_in(i));
+    ASSERT_LE(H::highest_in(i) - H::lowest_in(i), relative_error * H::lowest_in(i));
+    ASSERT_EQ(i, H::index_of(H::lowest_in(i)));
+    ASSERT_EQ(i, H::index_of(H::highest_in(i)));
+  }
+
+  srand(H::SUB_BUCKET_BITS);
+  for (unsigned n=0; n < 100000; ++n) {
+    uint32_t v = ((uint32_t) rand() << 16 ^ rand()) >> (rand() % 32);
+    if (v > H::HIGHEST) continue;
+
+    unsigned i = H::index_of(v);
+    ASSERT_LE(H::lowest_in(i), v);
+    ASSERT_GE(H::highest_in(i), v);
+  }
+}
+
+TEST(LogHistogramTest, TestBucketsOneDigit) {check_buckets<LogHistogram<1, 24> >(0.1);}
+TEST(LogHistogramTest, TestBucketsTwoDigits) {check_buckets<LogHistogram<2> >(0.01);}
+TEST(LogHistogramTest, TestBucketsThreeDigits) {check_buckets<LogHistogram<3> >(0.001);}
+
+TEST(LogHistogramTest, TestPercentiles) {
+  static LogHistogram<2> h;
+  std::vector<uint32_t> samples;
+
+  srand(19);
+  for (unsigned n=0; n < 20000; ++n) {
+    // mostly fast, with a long tail
+    uint32_t v = (rand() % 100 == 0) ? 1000 + rand() % 100000 : 20 + rand() % 200;
+    samples.push_back(v);
+    h += v;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  EXPECT_EQ(samples.size(), h.count);
+  EXPECT_EQ(samples.front(), h.min);
+  EXPECT_EQ(samples.back(), h.max);
+
+  for (float p : {1.0f, 10.0f, 50.0f, 90.0f, 99.0f, 99.9f, 99.99f}) {
+    uint32_t exact = samples[(size_t) ceil(p * samples.size() / 100.0) - 1];
+    uint32_t estimate = h.percentile(p);
+
+    EXPECT_GE(estimate, exact) << "p" << p;
+    EXPECT_LE(estimate, exact + exact / 100) << "p" << p;
+  }
+
+  EXPECT_EQ(samples.front(), h.percentile(0));
+  EXPECT_EQ(samples.back(), h.percentile(100));
+}
+
+TEST(LogHistogramTest, TestMerge) {
+  static LogHistogram<2, 24> a, b, both;
+
+  for (uint32_t v=0; v < 5000; ++v) {
+    uint32_t x = v * 37 % 4093, y = v * v % 100003;
+    a += x;
+    b += y;
+    both += x;
+    both += y;
+  }
+
+  LogHistogram<2, 24> snapshot = a;
+  a.reset();
+  EXPECT_EQ(0, a.count);
+
+  snapshot += b;
+  EXPECT_EQ(both.count, snapshot.count);
+  EXPECT_EQ(both.min, snapshot.min);
+  EXPECT_EQ(both.max, snapshot.max);
+  EXPECT_EQ(0, memcmp(both.buckets, snapshot.buckets, sizeof(both.buckets)));
+  EXPECT_EQ(both.percentile(95), snapshot.percentile(95));
+}
+
+TEST(LogHistogramTest, TestClampsLargeValues) {
+  LogHistogram<1, 16> h;
+
+  h += 1u << 20;
+  EXPECT_EQ(1, h.buckets[h.BUCKETS - 1]);
+  EXPECT_EQ(1u << 20, h.max);
+  EXPECT_EQ(0, h.percentile(50) >> 21);
+}
+
+TEST(LogHistogramTest, TestEmpty) {
+  LogHistogram<1> h;
+
+  EXPECT_EQ(0, h.percentile(99));
+  EXPECT_EQ(0, h.mean());
+}
+
+namespace {
+  // the fraction of sorted samples at or below value
+  double rank_of(const std::vector<double> &sorted, double value) {
+    return (std::upper_bound(sorted.begin(), sorted.end(), value) - sorted.begin()) / (double) sorted.size();
+  }
+
+  double uniform() {return rand() / (RAND_MAX + 1.0);}
+
+  double normal() {
+    // Box-Muller
+    return sqrt(-2*log(1 - uniform())) * cos(2*M_PI*uniform());
+  }
+
+  double exponential() {return -log(1 - uniform());}
+
+  void check_quantile(const char *name, double (*next)(), unsigned n) {
+    for (float q : {0.01f, 0.1f, 0.5f, 0.9f, 0.99f}) {
+      Quantile<double> estimator(q);
+      std::vector<double> samples;
+
+      srand(20);
+      for (unsigned i=0; i < n; ++i) {
+        double x = next();
+        samples.push_back(x);
+        estimator += x;
+      }
+
+      std::sort(samples.begin(), samples.end());
+      EXPECT_FLOAT_EQ(samples.front(), estimator.min());
+      EXPECT_FLOAT_EQ(samples.back(), estimator.max());
+
+      // P-squared is usually within a fraction of a percent in rank
+      EXPECT_NEAR(q, rank_of(samples, estimator.value()), 0.01) << name << " q=" << q;
+    }
+  }
+}
+
+TEST(QuantileTest, TestUniform) {check_quantile("uniform", uniform, 100000);}
+TEST(QuantileTest, TestNormal) {check_quantile("normal", normal, 100000);}
+TEST(QuantileTest, TestExponential) {check_quantile("exponential", exponential, 100000);}
+
+// long enough for float desired positions to stop growing
+TEST(QuantileTest, TestLongStream) {
+  Quantile<float> median, p90(0.9f);
+  uint32_t state = 24;
+
+  for (unsigned i=0; i < 20000000; ++i) {
+    state = state*1664525 + 1013904223;
+    float x = (state >> 8) * (1000.0f / (1 << 24));
+    median += x;
+    p90 += x;
+  }
+
+  EXPECT_NEAR(500, median.value(), 10);
+  EXPECT_NEAR(900, p90.value(), 10);
+}
+
+TEST(QuantileTest, TestSortedInput) {
+  Quantile<int> median, p90(0.9f);
+
+  for (int i=1; i <= 10001; ++i) {
+    median += i;
+    p90 += i;
+  }
+
+  EXPECT_NEAR(5001, median.value(), 50);
+  EXPECT_NEAR(9001, p90.value(), 50);
+}
+
+TEST(QuantileTest, TestFewSamplesAreExact) {
+  Quantile<int16_t> median;
+
+  EXPECT_EQ(0, median.value());
+  EXPECT_EQ(0, median.min());
+  EXPECT_EQ(0, median.max());
+  median += 7;
+  EXPECT_EQ(7, median.value());
+  median += 3;
+  median += 5;
+  EXPECT_EQ(5, median.value());
+  EXPECT_EQ(3, median.min());
+  EXPECT_EQ(7, median.max());
+
+  median.reset();
+  EXPECT_EQ(0, median.samples());
+}
+
+TEST(QuantileTest, TestIntegerValuesRound) {
+  // the markers are the same floats either way
+  for (float q : {0.1f, 0.5f, 0.9f}) {
+    Quantile<int> rounded(q);
+    Quantile<float> exact(q);
+
+    srand(25);
+    for (int i=0; i < 1000; ++i) {
+      int x = rand() % 201 - 100;
+      rounded += x;
+      exact += x;
+    }
+
+    EXPECT_EQ(lroundf(exact.value()), rounded.value()) << exact.value();
+  }
+}
+
+TEST(QuantileTest, TestMidrangeIsNotTheMedian) {
+  MaxMinMean<int> stats;
+  Quantile<int> median;
+
+  for (int x : {1, 2, 2, 3, 100}) {
+    stats += x;
+    median += x;
+  }
+
+  EXPECT_EQ(50, stats.midrange());
+  EXPECT_EQ(2, median.value());
+}
+
+template<class T>
+class BlockTest : public ::testing::Test {
+protected:
+  // a small range gives plenty of repeated minima and maxima
+  static T sample(int range) {return (T) (rand() % range - range/2);}
+};
+
+typedef ::testing::Types<int16_t, int32_t, float, uint8_t> BlockTypes;
+TYPED_TEST_CASE(BlockTest, BlockTypes);
+
+TYPED_TEST(BlockTest, TestMatchesScalar) {
+  TypeParam block[100];
+
+  srand(21);
+  for (unsigned round=0; round < 2000; ++round) {
+    MaxMinMean<TypeParam> scalar, blocked;
+    int range = round % 2 ? 10 : 200;
+
+    // a few blocks of assorted sizes, to cover the vector tails
+    for (unsigned b=0; b < 3; ++b) {
+      unsigned n = rand() % 100;
+
+      for (unsigned i=0; i < n; ++i) {
+        block[i] = TestFixture::sample(range);
+        scalar += block[i];
+      }
+      blocked.add_block(block, n);
+    }
+
+    ASSERT_EQ(scalar.count, blocked.count);
+    ASSERT_EQ(scalar.max.value, blocked.max.value);
+    ASSERT_EQ(scalar.max.index, blocked.max.index);
+    ASSERT_EQ(scalar.min.value, blocked.min.value);
+    ASSERT_EQ(scalar.min.index, blocked.min.index);
+    ASSERT_EQ(scalar.sum, blocked.sum); // small integers, exact even as floats
+  }
+}
+
+TEST(BlockTest, TestNegativeFloats) {
+  float block[] = {-3.5f, -1.25f, -7.0f, -1.25f, -2.0f};
+  Extrema<float> e;
+
+  e.add_block(block, 5);
+  EXPECT_EQ(-1.25f, e.max.value);
+  EXPECT_EQ(3, e.max.index);
+  EXPECT_EQ(-7.0f, e.min.value);
+  EXPECT_EQ(2, e.min.index);
+}
+
+namespace {
+  template<class T> void exact_moments(const std::vector<T> &x, double &mean, double &variance) {
+    mean = 0;
+    for (T v : x) mean += v;
+    mean /= x.size();
+
+    variance = 0;
+    for (T v : x) variance += (v - mean)*(v - mean);
+    variance /= x.size();
+  }
+}
+
+template<class T>
+class VarianceTest : public ::testing::Test {};
+
+typedef ::testing::Types<int16_t, uint16_t, int8_t, int32_t, float> VarianceTypes;
+TYPED_TEST_CASE(VarianceTest, VarianceTypes);
+
+// a small spread far from zero, where summing squares falls apart
+TYPED_TEST(VarianceTest, TestOffsetNoise) {
+  typedef std::numeric_limits<TypeParam> limits;
+  const double offset = limits::max() * 0.9, spread = std::min(50.0, limits::max() / 20.0);
+  Variance<TypeParam> v;
+  std::vector<TypeParam> samples;
+
+  srand(22);
+  for (unsigned i=0; i < 200000; ++i) {
+    TypeParam x = (TypeParam) (offset + spread * (2*uniform() - 1));
+    samples.push_back(x);
+    v += x;
+  }
+
+  double mean, variance;
+  exact_moments(samples, mean, variance);
+
+  EXPECT_EQ(samples.size(), v.count);
+  EXPECT_NEAR(mean, v.mean(), 1e-3 * spread + 1e-7 * mean); // floats above 2^24 are coarse
+  EXPECT_NEAR(variance, v.variance(), 1e-3 * variance);
+  EXPECT_NEAR(sqrt(variance), v.stddev(), 1e-3 * sqrt(variance));
+  EXPECT_NEAR(variance * samples.size() / (samples.size() - 1), v.sample_variance(), 1e-3 * variance);
+}
+
+TYPED_TEST(VarianceTest, TestMergeAndBlocks) {
+  TypeParam block[300];
+  Variance<TypeParam> one_at_a_time, merged, blocked;
+  std::vector<TypeParam> samples;
+
+  srand(23);
+  for (unsigned b=0; b < 50; ++b) {
+    Variance<TypeParam> part;
+    unsigned n = rand() % 300;
+    double sum = 0;
+
+    for (unsigned i=0; i < n; ++i) {
+      block[i] = (TypeParam) (rand() % 100 + (b % 7) * 10);
+      sum += block[i];
+      samples.push_back(block[i]);
+      one_at_a_time += block[i];
+      part += block[i];
+    }
+
+    merged += part;
+    blocked.add_block(block, n, sum);
+  }
+
+  double mean, variance;
+  exact_moments(samples, mean, variance);
+
+  for (const Variance<TypeParam> *v : {&one_at_a_time, &merged, &blocked}) {
+    EXPECT_EQ(samples.size(), v->count);
+    EXPECT_NEAR(mean, v->mean(), 1e-3);
+    EXPECT_NEAR(variance, v->variance(), 1e-3 * variance);
+  }
+}
+
+TEST(VarianceTest, TestEmptyAndConstant) {
+  Variance<int16_t> v;
+
+  EXPECT_EQ(0, v.variance());
+  EXPECT_EQ(0, v.sample_variance());
+
+  for (int i=0; i < 1000; ++i) v += -1234;
+  EXPECT_FLOAT_EQ(-1234, v.mean());
+  EXPECT_EQ(0, v.variance());
+}
+
+TEST(MaxMinMeanTest, TestLongRunDoesNotOverflow) {
+  static int16_t block[1 << 20];
+  MaxMinMean<int16_t, true> stats, blocked;
+
+  for (unsigned i=0; i < sizeof(block)/sizeof(block[0]); ++i) block[i] = 32767 - (i & 1);
+
+  for (unsigned i=0; i < sizeof(block)/sizeof(block[0]); ++i) stats += block[i];
+  blocked.add_block(block, sizeof(block)/sizeof(block[0]));
+
+  const int64_t expected = (int64_t) (1 << 19) * (32767 + 32766);
+  EXPECT_EQ(expected, stats.sum);
+  EXPECT_EQ(expected, blocked.sum);
+  EXPECT_EQ(32766, stats.mean());
+  EXPECT_NEAR(0.25, stats.variance(), 1e-3);
+  EXPECT_NEAR(0.25, blocked.variance(), 1e-3);
+  EXPECT_NEAR(0.5, blocked.stddev(), 1e-3);
+}
+
+// long enough for a single precision Welford update to lose its corrections
+TEST(MaxMinMeanTest, TestLongRunFloatVariance) {
+  MaxMinMean<float, true> stats;
+  uint32_t state = 26;
+
+  // uniform over 100 +/- sqrt(3), which has a variance of 1
+  for (unsigned i=0; i < 20000000; ++i) {
+    state = state*1664525 + 1013904223;
+    stats += 100 + ((state >> 8) * (1.0f / (1 << 24)) - 0.5f) * 3.4641016f;
+  }
+
+  EXPECT_NEAR(100, stats.spread.mean(), 1e-3);
+  EXPECT_NEAR(1, stats.variance(), 1e-3);
+}
+
+TEST(MaxMinMeanTest, TestInt32NearFullScale) {
+  int32_t block[67];
+  MaxMinMean<int32_t> stats, blocked;
+
+  // the sums overflow 32 bits many times over
+  for (unsigned i=0; i < 67; ++i) block[i] = i % 3 ? (1 << 30) + (int32_t) i : -2147483647 + (int32_t) i;
+
+  for (unsigned i=0; i < 67; ++i) stats += block[i];
+  blocked.add_block(block, 67);
+
+  int64_t expected = 0;
+  for (unsigned i=0; i < 67; ++i) expected += block[i];
+
+  EXPECT_EQ(expected, stats.sum);
+  EXPECT_EQ(expected, blocked.sum);
+  EXPECT_EQ(stats.mean(), blocked.mean());
+}
+
+TEST(MaxMinMeanTest, TestMerge) {
+  MaxMinMean<int, true> all, first, second;
+
+  for (int x : {5, 9, 1, 9}) {
+    all += x;
+    first += x;
+  }
+
+  for (int x : {1, 3, 9, 2}) {
+    all += x;
+    second += x;
+  }
+
+  first += second;
+  EXPECT_EQ(all.count, first.count);
+  EXPECT_EQ(all.sum, first.sum);
+  EXPECT_EQ(all.max.index, first.max.index);
+  EXPECT_EQ(6, first.max.index);
+  EXPECT_EQ(all.min.index, first.min.index);
+  EXPECT_EQ(4, first.min.index);
+  EXPECT_FLOAT_EQ(all.variance(), first.variance());
+  EXPECT_EQ(all.truncated_mean(), first.truncated_mean());
+}
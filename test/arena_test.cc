@@ -0,0 +1,86 @@
+#include <akt/arena.h>
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+using namespace akt;
+
+class ArenaTest : public ::testing::Test {
+protected:
+  enum {STORAGE_SIZE = 256};
+  alignas(Arena::DEFAULT_ALIGNMENT) uint64_t storage[STORAGE_SIZE/8];
+
+  ArenaTest() :
+    arena(storage, STORAGE_SIZE)
+  {
+  }
+
+  Arena arena;
+};
+
+TEST_F(ArenaTest, TestAllocate) {
+  char *a = arena.allocate<char>(3);
+  uint32_t *b = arena.allocate<uint32_t>(2);
+
+  ASSERT_TRUE(a != 0 && b != 0);
+  EXPECT_EQ(0, (uintptr_t) b % alignof(uint32_t));
+  EXPECT_GE((char *) b, a + 3);
+  EXPECT_EQ(12, arena.used());
+
+  void *c = arena.allocate(1, 64);
+  EXPECT_EQ(0, (uintptr_t) c % 64);
+}
+
+TEST_F(ArenaTest, TestExhausted) {
+  EXPECT_TRUE(arena.allocate(STORAGE_SIZE - 8, 1) != 0);
+  EXPECT_EQ(0, arena.allocate(9, 1));
+  EXPECT_TRUE(arena.allocate(8, 1) != 0);
+  EXPECT_EQ(0, arena.allocate(1, 1));
+  EXPECT_EQ(0, arena.allocate<uint32_t>((size_t) -1));
+  EXPECT_EQ(0, arena.available());
+}
+
+TEST_F(ArenaTest, TestNestedScopes) {
+  arena.allocate(10, 1);
+
+  {
+    Arena::Scope outer(arena);
+    arena.allocate(20, 1);
+
+    {
+      Arena::Scope inner(arena);
+      arena.allocate(30, 1);
+      EXPECT_EQ(60, arena.used());
+    }
+
+    EXPECT_EQ(30, arena.used());
+  }
+
+  EXPECT_EQ(10, arena.used());
+  EXPECT_EQ(60, arena.high_water());
+}
+
+TEST_F(ArenaTest, TestDeallocateLast) {
+  // aligned to the size, since the default alignment grows with AVX
+  void *a = arena.allocate(16, 16);
+  void *b = arena.allocate(16, 16);
+
+  arena.deallocate(a, 16); // not the last one, nothing happens
+  EXPECT_EQ(32, arena.used());
+
+  arena.deallocate(b, 16);
+  EXPECT_EQ(16, arena.used());
+  EXPECT_EQ(b, arena.allocate(16, 16));
+}
+
+TEST_F(ArenaTest, TestAllocator) {
+  Arena::Scope scope(arena);
+  std::vector<int, ArenaAllocator<int> > v((ArenaAllocator<int>(arena)));
+
+  for (int i=0; i < 20; ++i) v.push_back(i);
+  for (int i=0; i < 20; ++i) EXPECT_EQ(i, v[i]);
+
+  EXPECT_GE((uint8_t *) &v[0], (uint8_t *) storage);
+  EXPECT_LT((uint8_t *) &v[19], (uint8_t *) storage + STORAGE_SIZE);
+}
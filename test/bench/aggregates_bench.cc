@@ -0,0 +1,115 @@
+#include "bench.h"
+
+#include <akt/aggregates.h>
+
+#include <cstdlib>
+
+using namespace akt;
+using namespace bench;
+
+namespace {
+  enum {SAMPLES = 10000000};
+
+  uint32_t latencies[4096];
+
+  void fill_latencies() {
+    srand(1);
+    for (unsigned i=0; i < 4096; ++i) {
+      latencies[i] = (rand() % 100 == 0) ? 1000 + rand() % 100000 : 20 + rand() % 200;
+    }
+  }
+
+  template<class H> void record(const char *label, H &h) {
+    Stopwatch timer;
+
+    for (unsigned i=0; i < SAMPLES; ++i) h += latencies[i & 4095];
+    keep(h);
+    report(label, SAMPLES, timer.seconds());
+  }
+}
+
+BENCHMARK(HistogramRecord) {
+  static Histogram<uint32_t, 1024> linear(0, 100000);
+  static LogHistogram<1, 24> one;
+  static LogHistogram<2> two;
+  static LogHistogram<3> three;
+
+  fill_latencies();
+  record("Histogram<1024> (linear)", linear);
+  record("LogHistogram<1,24>", one);
+  record("LogHistogram<2>", two);
+  record("LogHistogram<3>", three);
+
+  Stopwatch timer;
+  uint32_t p = 0;
+  for (unsigned i=0; i < 1000; ++i) p += two.percentile(99);
+  keep(p);
+  report("LogHistogram<2>::percentile(99)", 1000, timer.seconds());
+}
+
+BENCHMARK(QuantileUpdate) {
+  static int16_t samples[4096];
+  Quantile<int16_t> median, p99(0.99f);
+  MaxMinMean<int16_t> stats;
+
+  srand(2);
+  for (unsigned i=0; i < 4096; ++i) samples[i] = rand() % 4096 - 2048;
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < SAMPLES; ++i) stats += samples[i & 4095];
+    keep(stats);
+    report("MaxMinMean<int16_t>", SAMPLES, timer.seconds());
+  }
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < SAMPLES; ++i) median += samples[i & 4095];
+    keep(median);
+    report("Quantile<int16_t>(0.5)", SAMPLES, timer.seconds());
+  }
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < SAMPLES; ++i) p99 += samples[i & 4095];
+    keep(p99);
+    report("Quantile<int16_t>(0.99)", SAMPLES, timer.seconds());
+  }
+}
+
+namespace {
+  enum {BLOCK = 256};
+
+  template<class T> void block_update(const char *type) {
+    static T samples[BLOCK * 16];
+    char label[64];
+
+    srand(3);
+    for (unsigned i=0; i < BLOCK * 16; ++i) samples[i] = (T) (rand() % 4096 - 2048);
+
+    {
+      MaxMinMean<T> stats;
+      Stopwatch timer;
+      for (unsigned i=0; i < SAMPLES; ++i) stats += samples[i % (BLOCK * 16)];
+      keep(stats);
+      snprintf(label, sizeof(label), "MaxMinMean<%s> +=", type);
+      report(label, SAMPLES, timer.seconds(), (double) SAMPLES * sizeof(T));
+    }
+
+    {
+      MaxMinMean<T> stats;
+      Stopwatch timer;
+      for (unsigned i=0; i < SAMPLES; i += BLOCK) stats.add_block(samples + i % (BLOCK * 16), BLOCK);
+      keep(stats);
+      snprintf(label, sizeof(label), "MaxMinMean<%s>::add_block", type);
+      report(label, SAMPLES, timer.seconds(), (double) SAMPLES * sizeof(T));
+    }
+  }
+}
+
+// ops are samples, in blocks of 256
+BENCHMARK(BlockUpdate) {
+  block_update<int16_t>("int16_t");
+  block_update<int32_t>("int32_t");
+  block_update<float>("float");
+}
@@ -0,0 +1,67 @@
+// -*- Mode:C++ -*-
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <stdint.h>
+
+/**
+ * @file    bench.h
+ * @brief   Minimal host-side micro benchmark harness
+ *
+ * @details Each benchmark is a static instance of a Benchmark subclass,
+ *          normally declared with the BENCHMARK macro. The constructor adds
+ *          the instance to a global singly linked list and
+ *          bench_main.cc runs every registered benchmark whose name contains
+ *          the optional filter string given on the command line.
+ */
+
+namespace bench {
+  class Benchmark {
+    Benchmark *next;
+
+  public:
+    Benchmark(const char *name);
+
+    virtual void run() = 0;
+    const char *name;
+
+    static int run_all(const char *filter);
+
+  protected:
+    static Benchmark *&benchmarks();
+  };
+
+  class Stopwatch {
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    void restart() { start = std::chrono::steady_clock::now(); }
+
+    double seconds() const {
+      std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+      return d.count();
+    }
+  };
+
+  // keeps the optimizer from discarding a computed value
+  template<class T> inline void keep(const T &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+  }
+
+  // prints "<label> <ops/s> [<MB/s>]" in a fixed layout
+  void report(const char *label, double ops, double seconds, double bytes = 0);
+};
+
+#define BENCHMARK_CLASS_NAME(name) name##_Benchmark
+
+#define BENCHMARK(name)                                                 \
+  class BENCHMARK_CLASS_NAME(name) : public bench::Benchmark {          \
+  public:                                                               \
+    BENCHMARK_CLASS_NAME(name)() : bench::Benchmark(#name) {}           \
+    virtual void run() override;                                        \
+  } name##_instance;                                                    \
+  void BENCHMARK_CLASS_NAME(name)::run()
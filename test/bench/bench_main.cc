@@ -0,0 +1,55 @@
+#include "bench.h"
+
+#include <cstring>
+#include <cstdio>
+
+using namespace bench;
+
+Benchmark *&Benchmark::benchmarks() {
+  // function-local so that registration works regardless of static init order
+  static Benchmark *list = 0;
+  return list;
+}
+
+Benchmark::Benchmark(const char *name) :
+  next(benchmarks()),
+  name(name)
+{
+  benchmarks() = this;
+}
+
+int Benchmark::run_all(const char *filter) {
+  int count = 0;
+
+  // most recently registered first
+  for (Benchmark *i=benchmarks(); i != 0; i = i->next) {
+    if (filter && !strstr(i->name, filter)) continue;
+
+    printf("%s\n", i->name);
+    i->run();
+    count += 1;
+  }
+
+  return count;
+}
+
+void bench::report(const char *label, double ops, double seconds, double bytes) {
+  if (seconds <= 0) seconds = 1e-9;
+
+  if (bytes > 0) {
+    printf("  %-40s %12.0f ops/s %10.1f MB/s\n", label, ops/seconds, bytes/seconds/1e6);
+  } else {
+    printf("  %-40s %12.0f ops/s %10.2f ns/op\n", label, ops/seconds, 1e9*seconds/ops);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  const char *filter = (argc > 1) ? argv[1] : 0;
+
+  if (Benchmark::run_all(filter) == 0) {
+    printf("no benchmarks matched\n");
+    return 1;
+  }
+
+  return 0;
+}
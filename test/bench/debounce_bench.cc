@@ -0,0 +1,43 @@
+#include "bench.h"
+
+#include <akt/debounce.h>
+
+#include <cstdlib>
+
+using namespace akt;
+using namespace bench;
+
+namespace {
+  enum {UPDATES = 20000000};
+
+  uint32_t readings[1024];
+
+  template<class D, class Lanes> void updates(const char *label, Lanes (*widen)(uint32_t)) {
+    D d;
+    Lanes changed = Lanes();
+    Stopwatch timer;
+
+    for (unsigned i=0; i < UPDATES; ++i) changed = changed ^ d.update(widen(readings[i & 1023]));
+    keep(changed);
+    report(label, UPDATES, timer.seconds());
+  }
+
+  uint32_t as32(uint32_t x) {return x;}
+  uint64_t as64(uint32_t x) {return (uint64_t) x << 32 | x;}
+  Lanes128 as128(uint32_t x) {return Lanes128(as64(x), ~as64(x));}
+}
+
+// ops are updates of the whole bank
+BENCHMARK(DebounceUpdate) {
+  // switches that mostly hold still, with some bouncing
+  srand(4);
+  for (unsigned i=0; i < 1024; ++i) {
+    readings[i] = ((i / 64) % 2 ? 0xffff0000 : 0x0000ffff) ^ (rand() % 8 == 0 ? rand() : 0);
+  }
+
+  updates<Debounce, uint32_t>("Debounce (32, press only)", as32);
+  updates<VerticalDebounce<uint32_t, 5>, uint32_t>("VerticalDebounce<uint32_t, 5>", as32);
+  updates<VerticalDebounce<uint64_t, 5>, uint64_t>("VerticalDebounce<uint64_t, 5>", as64);
+  updates<VerticalDebounce<Lanes128, 5>, Lanes128>("VerticalDebounce<Lanes128, 5>", as128);
+  updates<VerticalDebounce<uint32_t, 16>, uint32_t>("VerticalDebounce<uint32_t, 16>", as32);
+}
@@ -0,0 +1,60 @@
+#include "bench.h"
+
+#include <akt/history.h>
+#include <akt/aggregates.h>
+
+#include <cstdlib>
+
+using namespace akt;
+using namespace bench;
+
+namespace {
+  enum {SAMPLES = 2000000, WINDOW = 64};
+
+  int16_t samples[4096];
+
+  void fill() {
+    srand(1);
+    for (unsigned i=0; i < sizeof(samples)/sizeof(samples[0]); ++i) samples[i] = rand() % 4096 - 2048;
+  }
+
+  // what callers had to do before: rescan the window for every sample
+  template<unsigned N> void rescan(const char *label) {
+    History<int16_t, N> history;
+    Stopwatch timer;
+
+    for (unsigned i=0; i < SAMPLES; ++i) {
+      history += samples[i & 4095];
+
+      MaxMinMean<int16_t> stats;
+      for (unsigned n=0; n < history.count(); ++n) stats += history[n];
+      keep(stats);
+    }
+
+    report(label, SAMPLES, timer.seconds());
+  }
+
+  template<unsigned N> void windowed(const char *label) {
+    static WindowedStats<int16_t, N> stats;
+    Stopwatch timer;
+
+    for (unsigned i=0; i < SAMPLES; ++i) {
+      stats += samples[i & 4095];
+      int16_t mean = stats.mean(), max = stats.max(), min = stats.min();
+      int64_t variance = stats.variance();
+      keep(mean);
+      keep(max);
+      keep(min);
+      keep(variance);
+    }
+
+    report(label, SAMPLES, timer.seconds());
+  }
+}
+
+BENCHMARK(WindowedStats) {
+  fill();
+  rescan<WINDOW>("rescan History<64>");
+  windowed<WINDOW>("WindowedStats<64>");
+  windowed<WINDOW - 1>("WindowedStats<63>");
+}
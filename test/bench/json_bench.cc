@@ -0,0 +1,83 @@
+#include "bench.h"
+
+#include <akt/json/reader.h>
+#include <akt/json/visitor.h>
+
+#include <cstdio>
+#include <string>
+
+using namespace akt::json;
+using namespace bench;
+
+namespace {
+  enum {BYTES = 64 << 20, UART_CHUNK = 64};
+
+  // a pretty printed settings file: indentation, short names and values
+  std::string config() {
+    std::string text("{\n");
+    char line[160];
+
+    for (unsigned i=0; i < 40; ++i) {
+      snprintf(line, sizeof(line),
+               "  \"channel_%u\": {\n"
+               "    \"name\": \"accelerometer axis %u\",\n"
+               "    \"enabled\": %s,\n"
+               "    \"rate\": %u,\n"
+               "    \"gain\": %u.25,\n"
+               "    \"thresholds\": [ %u, %u, %u ]\n"
+               "  }%s\n",
+               i, i, i % 3 ? "true" : "false", 100 * (i + 1), i, i, 2*i, 3*i, i < 39 ? "," : "");
+      text += line;
+    }
+
+    return text + "}\n";
+  }
+
+  // one compact record per line with long message strings
+  std::string log() {
+    static const char *messages[] = {
+      "connection established with peer after advertising for a while",
+      "supervision timeout, peer went out of range while a notification was pending",
+      "battery voltage sampled during radio activity, \\\"low\\\" threshold not reached",
+      "flash write of configuration block completed without retries"
+    };
+    std::string text("[\n");
+    char line[256];
+
+    for (unsigned i=0; i < 200; ++i) {
+      snprintf(line, sizeof(line),
+               "{\"time\":%u,\"level\":\"%s\",\"source\":\"bluetooth/att_channel\",\"message\":\"%s\"}%s\n",
+               1000 * i, i % 7 ? "info" : "warning", messages[i % 4], i < 199 ? "," : "");
+      text += line;
+    }
+
+    return text + "]\n";
+  }
+
+  void parse(const char *label, const std::string &text, unsigned chunk) {
+    char token_buffer[128];
+    Visitor visitor;
+    Reader reader(token_buffer, sizeof(token_buffer));
+    unsigned documents = BYTES / text.size();
+    Stopwatch timer;
+
+    for (unsigned i=0; i < documents; ++i) {
+      reader.reset(&visitor);
+      for (unsigned n=0; n < text.size(); n += chunk) {
+        reader.read(text.data() + n, text.size() - n < chunk ? text.size() - n : chunk);
+      }
+      if (!reader.is_done() || reader.had_error()) printf("%s: parse failed\n", label);
+    }
+
+    report(label, documents, timer.seconds(), (double) documents * text.size());
+  }
+}
+
+BENCHMARK(JSONRead) {
+  std::string c(config()), l(log());
+
+  parse("config, whole", c, c.size());
+  parse("config, 64 byte chunks", c, UART_CHUNK);
+  parse("log, whole", l, l.size());
+  parse("log, 64 byte chunks", l, UART_CHUNK);
+}
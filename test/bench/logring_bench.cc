@@ -0,0 +1,115 @@
+#include "bench.h"
+
+#include <akt/logring.h>
+#include <akt/ringbuffer.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace akt;
+using namespace bench;
+
+namespace {
+  enum {
+    STORAGE_SIZE = 4096,
+    RECORDS = 200000,            // in total, split among the producers
+    RECORD_LENGTH = 40           // a typical log line
+  };
+
+  // The old LogBase::write(): every producer takes the same mutex.
+  class MutexLog {
+    char storage[STORAGE_SIZE];
+    RingBuffer<char> fifo;
+    std::mutex mutex;
+
+  public:
+    MutexLog() : fifo(storage, STORAGE_SIZE) {}
+
+    bool write(const char *bytes, size_t len) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (fifo.write_capacity() < len) return false;
+      fifo.write(bytes, len);
+      return true;
+    }
+
+    size_t drain() {
+      std::lock_guard<std::mutex> lock(mutex);
+      RingSpans<char> spans = fifo.peek_read();
+      keep(spans);
+      fifo.consume(spans.length());
+      return spans.length();
+    }
+  };
+
+  class RecordLog {
+    uint32_t storage[STORAGE_SIZE/4];
+    LogRing fifo;
+
+  public:
+    RecordLog() : fifo(storage, sizeof(storage)) {}
+
+    bool write(const char *bytes, size_t len) {
+      return fifo.write(bytes, len);
+    }
+
+    size_t drain() {
+      const char *record;
+      size_t len, total = 0;
+
+      while ((record = fifo.peek(len)) != 0) {
+        keep(record);
+        fifo.consume();
+        total += len;
+      }
+
+      return total;
+    }
+  };
+
+  template<class L>
+  void contention(const char *name, unsigned producer_count) {
+    L *log = new L;
+    std::vector<std::thread> producers;
+    unsigned per_producer = RECORDS / producer_count;
+    char label[64];
+    Stopwatch timer;
+
+    for (unsigned p=0; p < producer_count; ++p) {
+      producers.push_back(std::thread([log, per_producer]() {
+        char line[RECORD_LENGTH];
+
+        for (unsigned i=0; i < RECORD_LENGTH; ++i) line[i] = 'a' + (i % 26);
+
+        for (unsigned i=0; i < per_producer; ) {
+          if (log->write(line, RECORD_LENGTH)) {
+            i += 1;
+          } else {
+            std::this_thread::yield(); // full, let the consumer run
+          }
+        }
+      }));
+    }
+
+    size_t total = 0, expected = (size_t) per_producer * producer_count * RECORD_LENGTH;
+
+    while (total < expected) {
+      size_t n = log->drain();
+      if (n == 0) std::this_thread::yield();
+      total += n;
+    }
+
+    for (unsigned p=0; p < producer_count; ++p) producers[p].join();
+
+    snprintf(label, sizeof(label), "%s, %u producer(s)", name, producer_count);
+    report(label, (double) per_producer * producer_count, timer.seconds(), (double) total);
+    delete log;
+  }
+}
+
+BENCHMARK(LogRingContention) {
+  for (unsigned producers=1; producers <= 8; producers *= 2) {
+    contention<MutexLog>("mutex + RingBuffer", producers);
+    contention<RecordLog>("LogRing", producers);
+  }
+}
@@ -0,0 +1,130 @@
+#include "bench.h"
+
+#include <akt/math.h>
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace akt;
+using namespace bench;
+
+namespace {
+  enum {CALLS = 10000000};
+
+  // the bit-by-bit loop isqrt() replaced, for comparison
+  unsigned short bitwise_isqrt(uint32_t a) {
+    uint32_t rem = 0;
+    unsigned int root = 0;
+
+    for (int i = 0; i < 16; i++) {
+      root <<= 1;
+      rem <<= 2;
+      rem += a >> 30;
+      a <<= 2;
+
+      if (root < rem) {
+        root++;
+        rem -= root;
+        root++;
+      }
+    }
+
+    return (unsigned short) (root >> 1);
+  }
+
+  struct xyz {
+    int16_t x, y, z;
+  };
+
+  uint32_t squares[1024];
+  xyz vectors[1024];
+
+  void fill() {
+    srand(5);
+    for (unsigned i=0; i < 1024; ++i) {
+      vectors[i].x = rand() % 4096 - 2048;
+      vectors[i].y = rand() % 4096 - 2048;
+      vectors[i].z = rand() % 4096 - 2048;
+      squares[i] = (uint32_t) vectors[i].x*vectors[i].x + vectors[i].y*vectors[i].y + vectors[i].z*vectors[i].z;
+    }
+  }
+}
+
+// ops are calls, on a mix of accelerometer-sized values
+BENCHMARK(FixedMath) {
+  fill();
+
+  {
+    uint32_t sum = 0;
+    Stopwatch timer;
+    for (unsigned i=0; i < CALLS; ++i) sum += bitwise_isqrt(squares[i & 1023]);
+    keep(sum);
+    report("isqrt, bit by bit", CALLS, timer.seconds());
+  }
+
+  {
+    uint32_t sum = 0;
+    Stopwatch timer;
+    for (unsigned i=0; i < CALLS; ++i) sum += isqrt(squares[i & 1023]);
+    keep(sum);
+    report("isqrt, CLZ + Newton", CALLS, timer.seconds());
+  }
+
+  {
+    uint32_t sum = 0;
+    Stopwatch timer;
+    for (unsigned i=0; i < CALLS; ++i) sum += rsqrt(squares[i & 1023]);
+    keep(sum);
+    report("rsqrt", CALLS, timer.seconds());
+  }
+
+  {
+    float sum = 0;
+    Stopwatch timer;
+    for (unsigned i=0; i < CALLS; ++i) sum += 1.0f/sqrtf((float) squares[i & 1023]);
+    keep(sum);
+    report("1.0f/sqrtf", CALLS, timer.seconds());
+  }
+
+  {
+    int32_t sum = 0;
+    Stopwatch timer;
+    for (unsigned i=0; i < CALLS; ++i) {
+      const xyz &v = vectors[i & 1023];
+      sum += akt::atan2(v.y, v.x).raw();
+    }
+    keep(sum);
+    report("atan2", CALLS, timer.seconds());
+  }
+
+  {
+    float sum = 0;
+    Stopwatch timer;
+    for (unsigned i=0; i < CALLS; ++i) {
+      const xyz &v = vectors[i & 1023];
+      sum += atan2f(v.y, v.x);
+    }
+    keep(sum);
+    report("atan2f", CALLS, timer.seconds());
+  }
+
+  {
+    uint32_t sum = 0;
+    Stopwatch timer;
+    for (unsigned i=0; i < CALLS; ++i) sum += magnitude(vectors[i & 1023]);
+    keep(sum);
+    report("magnitude", CALLS, timer.seconds());
+  }
+
+  {
+    int32_t sum = 0;
+    Stopwatch timer;
+    for (unsigned i=0; i < CALLS; ++i) {
+      Q15 x, y, z;
+      normalize(vectors[i & 1023], x, y, z);
+      sum += x.raw() + y.raw() + z.raw();
+    }
+    keep(sum);
+    report("normalize", CALLS, timer.seconds());
+  }
+}
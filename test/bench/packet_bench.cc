@@ -0,0 +1,156 @@
+#include "bench.h"
+
+#include <akt/bluetooth/packet.h>
+#include <akt/bluetooth/pdu.h>
+
+using namespace akt;
+using namespace akt::bluetooth;
+using namespace bench;
+
+namespace {
+  enum {PDUS = 2000000, ENTRIES = 5};
+
+  // an ATT find information response with a handful of 16-bit entries
+  void encode_checked(Packet &p, uint16_t first) {
+    p.l2cap(0x0040, 0x0004) << (uint8_t) 0x05 << (uint8_t) 0x01;
+
+    for (uint16_t i=0; i < ENTRIES; ++i) {
+      p << (uint16_t) (first + i) << (uint16_t) (0x2800 + i);
+    }
+  }
+
+  void encode_reserved(Packet &p, uint16_t first) {
+    p.l2cap(0x0040, 0x0004).reserve(2) << (uint8_t) 0x05 << (uint8_t) 0x01;
+
+    ByteCursor entries = p.reserve(ENTRIES * 2*sizeof(uint16_t));
+    for (uint16_t i=0; i < ENTRIES; ++i) {
+      entries << (uint16_t) (first + i) << (uint16_t) (0x2800 + i);
+    }
+  }
+
+  // the parameters of an LE connection complete event
+  struct Connection {
+    uint8_t status, role, peer_address_type, master_clock_accuracy;
+    uint16_t handle, interval, latency, timeout;
+    uint8_t peer_address[6];
+  };
+
+  void decode_checked(Packet &p, Connection &c) {
+    p.seek(0);
+    p >> c.status >> c.handle >> c.role >> c.peer_address_type;
+    p.read(c.peer_address, sizeof(c.peer_address));
+    p >> c.interval >> c.latency >> c.timeout >> c.master_clock_accuracy;
+  }
+
+  void decode_reserved(Packet &p, Connection &c) {
+    p.seek(0);
+    ByteCursor params = p.reserve(18);
+    params >> c.status >> c.handle >> c.role >> c.peer_address_type;
+    params.read(c.peer_address, sizeof(c.peer_address));
+    params >> c.interval >> c.latency >> c.timeout >> c.master_clock_accuracy;
+  }
+
+  void decode_view(Packet &p, Connection &c) {
+    p.seek(0);
+    const HCI::LEConnectionComplete &e = pdu<HCI::LEConnectionComplete>(p);
+    c.status = e.status;
+    c.handle = e.connection_handle;
+    c.role = e.role;
+    c.peer_address_type = e.peer_address_type;
+    memcpy(c.peer_address, e.peer_address, sizeof(c.peer_address));
+    c.interval = e.conn_interval;
+    c.latency = e.conn_latency;
+    c.timeout = e.supervision_timeout;
+    c.master_clock_accuracy = e.master_clock_accuracy;
+  }
+}
+
+BENCHMARK(PacketEncode) {
+  static SizedPacket<64> p;
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < PDUS; ++i) {
+      encode_checked(p, i);
+      keep(p);
+    }
+    report("operator<< per field", PDUS, timer.seconds());
+  }
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < PDUS; ++i) {
+      encode_reserved(p, i);
+      keep(p);
+    }
+    report("reserve() + ByteCursor", PDUS, timer.seconds());
+  }
+}
+
+BENCHMARK(PacketDecode) {
+  static SizedPacket<18> p;
+  Connection c;
+
+  for (unsigned i=0; i < 18; ++i) p << (uint8_t) i;
+  p.flip();
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < PDUS; ++i) {
+      decode_checked(p, c);
+      keep(c);
+    }
+    report("operator>> per field", PDUS, timer.seconds());
+  }
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < PDUS; ++i) {
+      decode_reserved(p, c);
+      keep(c);
+    }
+    report("reserve() + ByteCursor", PDUS, timer.seconds());
+  }
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < PDUS; ++i) {
+      decode_view(p, c);
+      keep(c);
+    }
+    report("pdu<LEConnectionComplete>", PDUS, timer.seconds());
+  }
+}
+
+// An ATT read response for a long attribute, with the value copied into
+// the packet or chained onto it as a segment.
+BENCHMARK(PacketReadResponse) {
+  enum {VALUE_SIZE = 240};
+  static SizedPacket<Packet::L2CAP_HEADER_SIZE + 1 + VALUE_SIZE> p;
+  static uint8_t value[VALUE_SIZE];
+  PacketSegment segment;
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < PDUS; ++i) {
+      value[0] = i;
+      p.l2cap(0x0040, 0x0004) << (uint8_t) 0x0b;
+      p.write(value, VALUE_SIZE);
+      p.prepare_for_tx();
+      keep(p);
+    }
+    report("copied value", PDUS, timer.seconds(), (double) PDUS * VALUE_SIZE);
+  }
+
+  {
+    Stopwatch timer;
+    for (unsigned i=0; i < PDUS; ++i) {
+      value[0] = i;
+      p.l2cap(0x0040, 0x0004) << (uint8_t) 0x0b;
+      p.append(segment.assign(value, VALUE_SIZE));
+      p.prepare_for_tx();
+      keep(p);
+    }
+    report("chained segment", PDUS, timer.seconds(), (double) PDUS * VALUE_SIZE);
+  }
+}
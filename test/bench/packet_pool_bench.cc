@@ -0,0 +1,82 @@
+#include "bench.h"
+
+#include <akt/bluetooth/packet.h>
+
+using namespace akt;
+using namespace akt::bluetooth;
+using namespace bench;
+
+namespace {
+  enum {PAIRS = 2000000};
+
+  // what H4 used before, and what it uses now
+  typedef LockFreePacketPool<1000, 4> FixedPool;
+  typedef SlabPacketPool<SizeClass<32, 8>,
+                         SizeClass<64, 4>,
+                         SizeClass<128, 4>,
+                         SizeClass<256, 4>,
+                         SizeClass<1024, 1> > SlabPool;
+
+  // Packet lengths (with H4 framing) of a typical LE link: mostly 27 byte
+  // payloads, some mid-sized ATT PDUs and the occasional 251 byte one.
+  unsigned next_length(uint32_t &seed) {
+    seed = seed * 1103515245 + 12345;
+    unsigned r = (seed >> 16) % 100;
+
+    if (r < 70) return 1+4+27;
+    if (r < 85) return 1+4+4+(r % 50);
+    if (r < 97) return 1+4+251;
+    return 1+4+600;
+  }
+
+  Packet *allocate(FixedPool &pool, unsigned length) {return pool.allocate();}
+  Packet *allocate(SlabPool &pool, unsigned length) {return pool.allocate(length);}
+
+  // allocates a burst until the pool runs dry and reports how much of the
+  // reserved packet memory actually holds data
+  template<class P> void burst(const char *name) {
+    static P pool;
+    Packet *held[64];
+    unsigned count = 0, used = 0, reserved = 0;
+    uint32_t seed = 1;
+
+    while (count < 64) {
+      unsigned length = next_length(seed);
+      Packet *p = allocate(pool, length);
+
+      if (p == 0) break;
+      held[count++] = p;
+      used += length;
+      reserved += p->capacity();
+    }
+
+    printf("  %-30s %6u bytes, %2u packets in a burst, %5.1f%% of reserved bytes used\n",
+           name, (unsigned) sizeof(P), count, 100.0 * used / reserved);
+
+    for (unsigned i=0; i < count; ++i) held[i]->deallocate();
+  }
+
+  template<class P> void pairs(const char *name) {
+    static P pool;
+    uint32_t seed = 1;
+    Stopwatch timer;
+
+    for (unsigned i=0; i < PAIRS; ++i) {
+      Packet *p = allocate(pool, next_length(seed));
+      keep(p);
+      p->deallocate();
+    }
+
+    report(name, PAIRS, timer.seconds());
+  }
+}
+
+BENCHMARK(PacketPoolMemory) {
+  burst<FixedPool>("LockFreePacketPool<1000, 4>");
+  burst<SlabPool>("SlabPacketPool (H4)");
+}
+
+BENCHMARK(PacketPoolAllocateFreePairs) {
+  pairs<FixedPool>("LockFreePacketPool<1000, 4>");
+  pairs<SlabPool>("SlabPacketPool (H4)");
+}
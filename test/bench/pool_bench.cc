@@ -0,0 +1,135 @@
+#include "bench.h"
+
+#include <akt/pool.h>
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace akt;
+using namespace bench;
+
+namespace {
+  enum {PAIRS = 2000000}; // in total, split among the threads
+
+  struct Item : public Ring<Item> {
+    uint8_t payload[64];
+    void reset() {}
+  };
+
+  // Pool isn't thread safe, so sharing it means taking a lock
+  class LockedPool {
+    Pool<Item, 16> pool;
+    std::mutex mutex;
+
+  public:
+    Item *allocate() {
+      std::lock_guard<std::mutex> lock(mutex);
+      return pool.allocate();
+    }
+
+    void deallocate(Item *p) {
+      std::lock_guard<std::mutex> lock(mutex);
+      pool.deallocate(p);
+    }
+  };
+
+  template<class P>
+  void pairs(const char *name, unsigned thread_count) {
+    P *pool = new P;
+    std::vector<std::thread> threads;
+    unsigned per_thread = PAIRS / thread_count;
+    char label[64];
+    Stopwatch timer;
+
+    for (unsigned t=0; t < thread_count; ++t) {
+      threads.push_back(std::thread([pool, per_thread]() {
+        for (unsigned i=0; i < per_thread; ++i) {
+          Item *p = pool->allocate();
+          if (p == 0) continue; // drained by the other threads
+          keep(p);
+          pool->deallocate(p);
+        }
+      }));
+    }
+
+    for (unsigned t=0; t < thread_count; ++t) threads[t].join();
+
+    snprintf(label, sizeof(label), "%s, %u thread(s)", name, thread_count);
+    report(label, (double) per_thread * thread_count, timer.seconds());
+    delete pool;
+  }
+}
+
+BENCHMARK(PoolAllocateFreePairs) {
+  {
+    Pool<Item, 16> pool;
+    Stopwatch timer;
+
+    for (unsigned i=0; i < PAIRS; ++i) {
+      Item *p = pool.allocate();
+      keep(p);
+      pool.deallocate(p);
+    }
+
+    report("Pool (unsynchronized), 1 thread", PAIRS, timer.seconds());
+  }
+
+  for (unsigned threads=1; threads <= 8; threads *= 2) {
+    pairs<LockedPool>("mutex + Pool", threads);
+    pairs<LockFreePool<Item, 16> >("LockFreePool", threads);
+  }
+}
+
+namespace {
+  enum {ROUNDS = 20000, OBJECTS = 64};
+
+  // allocates the whole pool, frees it in a scrambled order and touches
+  // every object on the way, the way a connection table or packet queue
+  // churns over time
+  template<class P> void churn(const char *name) {
+    static P pool;
+    Item *items[OBJECTS];
+    uint32_t seed = 1;
+    Stopwatch timer;
+
+    for (unsigned r=0; r < ROUNDS; ++r) {
+      for (unsigned i=0; i < OBJECTS; ++i) {
+        items[i] = pool.allocate();
+        items[i]->payload[0] = i;
+      }
+
+      for (unsigned i=OBJECTS-1; i > 0; --i) {
+        seed = seed * 1103515245 + 12345;
+        unsigned j = (seed >> 16) % (i + 1);
+        Item *t = items[i]; items[i] = items[j]; items[j] = t;
+      }
+
+      for (unsigned i=0; i < OBJECTS; ++i) pool.deallocate(items[i]);
+    }
+
+    report(name, (double) ROUNDS * OBJECTS, timer.seconds());
+  }
+
+  template<class P> void resets(const char *name) {
+    static P pool;
+    Stopwatch timer;
+
+    for (unsigned r=0; r < ROUNDS; ++r) {
+      pool.reset();
+      keep(pool);
+    }
+
+    report(name, ROUNDS, timer.seconds());
+  }
+}
+
+BENCHMARK(BitmapPoolChurn) {
+  churn<Pool<Item, OBJECTS> >("Pool<Item, 64>");
+  churn<BitmapPool<Item, OBJECTS> >("BitmapPool<Item, 64>");
+}
+
+BENCHMARK(BitmapPoolReset) {
+  resets<Pool<Item, OBJECTS> >("Pool<Item, 64>::reset");
+  resets<BitmapPool<Item, OBJECTS> >("BitmapPool<Item, 64>::reset");
+}
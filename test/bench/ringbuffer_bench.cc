@@ -0,0 +1,169 @@
+#include "bench.h"
+
+#include <akt/ringbuffer.h>
+
+#include <mutex>
+#include <thread>
+
+using namespace akt;
+using namespace bench;
+
+namespace {
+  enum {
+    CAPACITY = 1024,
+    BYTES = 16 * 1024 * 1024
+  };
+
+  // Wraps RingBuffer in a mutex, which is what LogBase and the UART
+  // consumers have to do today.
+  class LockedRingBuffer {
+    RingBuffer<char> ring;
+    std::mutex mutex;
+
+  public:
+    LockedRingBuffer(char *s, size_t capacity) : ring(s, capacity) {}
+
+    size_t write(const char *src, size_t n) {
+      std::lock_guard<std::mutex> lock(mutex);
+      return ring.write(src, n);
+    }
+
+    size_t read(char *dst, size_t n) {
+      std::lock_guard<std::mutex> lock(mutex);
+      return ring.read(dst, n);
+    }
+  };
+
+  template<class R>
+  void producer_consumer(const char *label, size_t chunk) {
+    static char storage[CAPACITY];
+    R ring(storage, CAPACITY);
+    Stopwatch timer;
+
+    std::thread producer([&ring, chunk]() {
+      char block[256];
+      size_t remaining = BYTES;
+
+      for (size_t i=0; i < sizeof(block); ++i) block[i] = (char) i;
+
+      while (remaining > 0) {
+        size_t n = ring.write(block, (remaining < chunk) ? remaining : chunk);
+        if (n == 0) std::this_thread::yield(); // full
+        remaining -= n;
+      }
+    });
+
+    std::thread consumer([&ring, chunk]() {
+      char block[256];
+      size_t remaining = BYTES;
+
+      while (remaining > 0) {
+        size_t n = ring.read(block, chunk);
+        if (n == 0) std::this_thread::yield(); // empty
+        remaining -= n;
+        keep(block);
+      }
+    });
+
+    producer.join();
+    consumer.join();
+
+    report(label, BYTES/chunk, timer.seconds(), BYTES);
+  }
+}
+
+BENCHMARK(RingBufferProducerConsumer) {
+  const size_t chunks[] = {1, 16, 256};
+  char label[64];
+
+  for (size_t i=0; i < sizeof(chunks)/sizeof(chunks[0]); ++i) {
+    snprintf(label, sizeof(label), "mutex + RingBuffer, %u byte chunks", (unsigned) chunks[i]);
+    producer_consumer<LockedRingBuffer>(label, chunks[i]);
+
+    snprintf(label, sizeof(label), "SPSCRingBuffer, %u byte chunks", (unsigned) chunks[i]);
+    producer_consumer<SPSCRingBuffer<char> >(label, chunks[i]);
+  }
+}
+
+namespace {
+  enum {PER_BYTE_ROUNDS = 4 * 1024 * 1024};
+
+  // Alternates small writes and reads so the indices wrap constantly; this
+  // is the pattern of a UART rx buffer drained by a thread.
+  template<class R>
+  void per_byte(const char *label, R &ring) {
+    char src[3] = {'a', 'b', 'c'}, dst[3];
+    Stopwatch timer;
+
+    for (unsigned i=0; i < PER_BYTE_ROUNDS; ++i) {
+      ring.write(src, 3);
+      ring.read(dst, 3);
+      keep(dst);
+    }
+
+    report(label, 3.0 * PER_BYTE_ROUNDS, timer.seconds());
+  }
+
+  template<class R>
+  void peek_poke(const char *label, R &ring) {
+    char block[100] = {0};
+    unsigned sum = 0;
+    Stopwatch timer;
+
+    for (unsigned i=0; i < PER_BYTE_ROUNDS/64; ++i) {
+      ring.write(block, sizeof(block));
+      for (int j=0; j < 64; ++j) sum += ring.peek(j);
+      ring.skip(sizeof(block));
+    }
+
+    keep(sum);
+    report(label, 64.0 * (PER_BYTE_ROUNDS/64), timer.seconds());
+  }
+}
+
+BENCHMARK(RingBufferPerByte) {
+  static char storage[256];
+  RingBuffer<char> ring(storage, sizeof(storage));
+  StaticRingBuffer<char, 256> static_ring;
+
+  per_byte("RingBuffer read/write, per byte", ring);
+  per_byte("StaticRingBuffer read/write, per byte", static_ring);
+
+  peek_poke("RingBuffer peek, per byte", ring);
+  peek_poke("StaticRingBuffer peek, per byte", static_ring);
+}
+
+namespace {
+  // Not trivially copyable, so RingBuffer falls back to its element loop.
+  // This reproduces the cost of the original per-element implementation.
+  struct Byte {
+    char c;
+    Byte &operator=(const Byte &other) { c = other.c; return *this; }
+  };
+
+  template<class T>
+  void run_size_matrix(const char *name) {
+    static T storage[8192], block[4096];
+    RingBuffer<T> ring(storage, 8192 - 5); // odd size so runs split sometimes
+    char label[64];
+
+    for (size_t run=1; run <= 4096; run *= 4) {
+      size_t rounds = (32 * 1024 * 1024) / run;
+      Stopwatch timer;
+
+      for (size_t i=0; i < rounds; ++i) {
+        ring.write(block, run);
+        ring.read(block, run);
+      }
+
+      keep(block);
+      snprintf(label, sizeof(label), "%s, %4u byte runs", name, (unsigned) run);
+      report(label, (double) rounds, timer.seconds(), 2.0 * rounds * run);
+    }
+  }
+}
+
+BENCHMARK(RingBufferRunSizes) {
+  run_size_matrix<Byte>("element loop");
+  run_size_matrix<char>("copy_run");
+}
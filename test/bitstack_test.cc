@@ -0,0 +1,63 @@
+#include <akt/bitstack.h>
+
+#include <gtest/gtest.h>
+
+using namespace akt;
+
+TEST(BitStackTest, TestEmptyAndFull) {
+  BitStack<2, 3> stack;
+
+  EXPECT_TRUE(stack.empty());
+  EXPECT_EQ(3, stack.space_remaining());
+
+  EXPECT_TRUE(stack.push(1));
+  EXPECT_TRUE(stack.push(2));
+  EXPECT_TRUE(stack.push(3));
+  EXPECT_TRUE(stack.full());
+  EXPECT_FALSE(stack.push(0));
+  EXPECT_EQ(3, stack.depth());
+
+  stack.reset();
+  EXPECT_TRUE(stack.empty());
+}
+
+TEST(BitStackTest, TestPushPop) {
+  BitStack<2, 100> stack;
+  unsigned value;
+
+  // crosses several word boundaries
+  for (unsigned i=0; i < 100; ++i) ASSERT_TRUE(stack.push(i % 4));
+
+  for (unsigned i=100; i > 0; --i) {
+    ASSERT_TRUE(stack.pop(value));
+    EXPECT_EQ((i-1) % 4, value);
+  }
+
+  EXPECT_FALSE(stack.pop(value));
+}
+
+TEST(BitStackTest, TestReplaceTop) {
+  BitStack<1, 40> stack;
+
+  for (unsigned i=0; i < 40; ++i) stack.push(0);
+  stack.replace_top(1);
+  EXPECT_EQ(1, stack.top());
+
+  unsigned value;
+  stack.pop(value);
+  EXPECT_EQ(0, stack.top());
+}
+
+TEST(BitStackTest, TestWideValues) {
+  BitStack<8, 5> stack;
+  unsigned value;
+
+  EXPECT_EQ(255, stack.MAX_VALUE);
+  stack.push(0xab);
+  stack.push(0xff);
+  stack.push(0x01);
+
+  stack.pop(value); EXPECT_EQ(0x01, value);
+  stack.pop(value); EXPECT_EQ(0xff, value);
+  stack.pop(value); EXPECT_EQ(0xab, value);
+}
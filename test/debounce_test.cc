@@ -0,0 +1,116 @@
+#include <akt/debounce.h>
+
+#include <gtest/gtest.h>
+
+using namespace akt;
+
+namespace {
+  enum {STEPS = 16}; // every sequence of this many raw readings is tried
+
+  // a single lane
+  uint32_t shifted(uint32_t one, unsigned j) {return one << j;}
+  uint64_t shifted(uint64_t one, unsigned j) {return one << j;}
+  Lanes128 shifted(Lanes128, unsigned j) {return j < 64 ? Lanes128(1ull << j, 0) : Lanes128(0, 1ull << (j - 64));}
+
+  // lane j of batch b sees the bits of sequence b*lanes + j, one per step
+  template<class Lanes> Lanes raw_for(unsigned batch, unsigned step, unsigned lanes, Lanes one) {
+    Lanes raw = Lanes();
+
+    for (unsigned j=0; j < lanes; ++j) {
+      if (((batch*lanes + j) >> step) & 1) raw = raw | shifted(one, j);
+    }
+
+    return raw;
+  }
+
+  // the obvious per-switch version
+  struct ScalarDebounce {
+    bool state;
+    unsigned count;
+
+    ScalarDebounce() : state(false), count(0) {}
+
+    void update(bool raw, unsigned dwell) {
+      if (raw == state) {
+        count = 0;
+      } else if (++count == dwell) {
+        state = raw;
+        count = 0;
+      }
+    }
+  };
+
+  template<class Lanes, unsigned Dwell, unsigned LANES> void check_against_scalar() {
+    for (unsigned batch=0; batch < (1u << STEPS) / LANES; ++batch) {
+      VerticalDebounce<Lanes, Dwell> vertical;
+      ScalarDebounce scalar[LANES];
+
+      for (unsigned step=0; step < STEPS; ++step) {
+        Lanes raw = raw_for(batch, step, LANES, Lanes(1));
+        Lanes before = vertical.state();
+        Lanes changed = vertical.update(raw);
+
+        ASSERT_TRUE((before ^ vertical.state()) == changed);
+
+        for (unsigned j=0; j < LANES; ++j) {
+          scalar[j].update((bool) (raw & shifted(Lanes(1), j)), Dwell);
+          ASSERT_EQ(scalar[j].state, (bool) (vertical.state() & shifted(Lanes(1), j)))
+            << "dwell " << Dwell << ", sequence " << batch*LANES + j << ", step " << step;
+        }
+      }
+    }
+  }
+}
+
+// Presses must match Debounce exactly, and releases must match Debounce
+// run on the inverted readings, since they're debounced the same way.
+TEST(VerticalDebounceTest, TestMatchesDebounce) {
+  for (unsigned batch=0; batch < (1u << STEPS) / 32; ++batch) {
+    VerticalDebounce<uint32_t, Debounce::DWELL> vertical;
+    Debounce pressed, released;
+
+    for (unsigned step=0; step < STEPS; ++step) {
+      uint32_t raw = raw_for(batch, step, 32, (uint32_t) 1);
+      uint32_t was_pressed = vertical.state();
+
+      vertical.update(raw);
+      pressed.update(raw);
+      released.update(~raw);
+
+      ASSERT_EQ(pressed.state() & ~was_pressed, vertical.state() & ~was_pressed)
+        << "batch " << batch << ", step " << step;
+      ASSERT_EQ(~released.state() & was_pressed, vertical.state() & was_pressed)
+        << "batch " << batch << ", step " << step;
+    }
+  }
+}
+
+TEST(VerticalDebounceTest, TestDwellOne) {check_against_scalar<uint32_t, 1, 32>();}
+TEST(VerticalDebounceTest, TestDwellTwo) {check_against_scalar<uint32_t, 2, 32>();}
+TEST(VerticalDebounceTest, TestDwellThree) {check_against_scalar<uint32_t, 3, 32>();}
+TEST(VerticalDebounceTest, TestDwellFour) {check_against_scalar<uint32_t, 4, 32>();}
+TEST(VerticalDebounceTest, TestDwellEight) {check_against_scalar<uint32_t, 8, 32>();}
+TEST(VerticalDebounceTest, Test64Lanes) {check_against_scalar<uint64_t, 5, 64>();}
+TEST(VerticalDebounceTest, Test128Lanes) {check_against_scalar<Lanes128, 5, 128>();}
+
+TEST(VerticalDebounceTest, TestCounterBits) {
+  EXPECT_EQ(1, (VerticalDebounce<uint32_t, 1>::COUNTER_BITS));
+  EXPECT_EQ(1, (VerticalDebounce<uint32_t, 2>::COUNTER_BITS));
+  EXPECT_EQ(2, (VerticalDebounce<uint32_t, 4>::COUNTER_BITS));
+  EXPECT_EQ(3, (VerticalDebounce<uint32_t, 5>::COUNTER_BITS));
+  EXPECT_EQ(3, (VerticalDebounce<uint32_t, 8>::COUNTER_BITS));
+  EXPECT_EQ(4, (VerticalDebounce<uint32_t, 9>::COUNTER_BITS));
+}
+
+TEST(VerticalDebounceTest, TestReset) {
+  VerticalDebounce<uint64_t, 2> d;
+
+  d.update(~0ull);
+  d.update(~0ull);
+  EXPECT_EQ(~0ull, d.state());
+
+  d.reset();
+  EXPECT_EQ(0ull, d.state());
+  d.update(1);
+  EXPECT_EQ(0ull, d.state()); // the counters were cleared as well
+}
@@ -0,0 +1,122 @@
+#include <akt/history.h>
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <type_traits>
+
+using namespace akt;
+
+TEST(HistoryTest, TestIndexFromLatest) {
+  History<int, 5> h;
+
+  for (int i=1; i <= 3; ++i) h += i;
+  EXPECT_EQ(3, h.count());
+  EXPECT_EQ(3, h[0]);
+  EXPECT_EQ(2, h[1]);
+  EXPECT_EQ(1, h[2]);
+  EXPECT_EQ(0, h[3]); // not filled yet
+
+  for (int i=4; i <= 12; ++i) h += i;
+  EXPECT_EQ(5, h.count());
+  for (unsigned n=0; n < 5; ++n) EXPECT_EQ(12 - (int) n, h[n]);
+}
+
+TEST(HistoryTest, TestIndexPowerOfTwo) {
+  History<int, 8> h;
+
+  for (int i=1; i <= 11; ++i) h += i;
+  for (unsigned n=0; n < 8; ++n) EXPECT_EQ(11 - (int) n, h[n]);
+}
+
+template<class W>
+class WindowedStatsTest : public ::testing::Test {
+protected:
+  W stats;
+};
+
+typedef ::testing::Types<WindowedStats<int16_t, 7>,
+                         WindowedStats<int16_t, 16>,
+                         WindowedStats<int32_t, 1>,
+                         WindowedStats<float, 10> > WindowedStatsTypes;
+TYPED_TEST_CASE(WindowedStatsTest, WindowedStatsTypes);
+
+// compares against a rescan of the window after every sample
+TYPED_TEST(WindowedStatsTest, TestMatchesRescan) {
+  const unsigned N = TypeParam::SIZE;
+  std::deque<double> window;
+
+  srand(N);
+  for (unsigned i=0; i < 5000; ++i) {
+    // runs of rising and falling samples exercise the queues
+    int16_t sample = (i / 50) % 2 ? (int16_t) (rand() % 2001 - 1000) : (int16_t) (i % 100);
+
+    this->stats += sample;
+    window.push_back(sample);
+    if (window.size() > N) window.pop_front();
+
+    double sum = 0, squares = 0;
+    for (double x : window) {
+      sum += x;
+      squares += x*x;
+    }
+
+    double n = window.size(), mean = sum/n;
+
+    ASSERT_EQ(window.size(), this->stats.count());
+    ASSERT_EQ(*std::max_element(window.begin(), window.end()), this->stats.max());
+    ASSERT_EQ(*std::min_element(window.begin(), window.end()), this->stats.min());
+    ASSERT_NEAR(mean, this->stats.mean(), 1.0);
+    ASSERT_NEAR(squares/n - mean*mean, this->stats.variance(), 1e-3*squares/n + 1.0);
+  }
+}
+
+TYPED_TEST(WindowedStatsTest, TestReset) {
+  this->stats += 100;
+  this->stats += -100;
+  this->stats.reset();
+
+  EXPECT_EQ(0, this->stats.count());
+  this->stats += 5;
+  EXPECT_EQ(5, this->stats.max());
+  EXPECT_EQ(5, this->stats.min());
+  EXPECT_EQ(5, this->stats.mean());
+  EXPECT_EQ(0, this->stats.variance());
+}
+
+TEST(WindowedStatsTest, TestReadOnlyHistory) {
+  WindowedStats<int, 4> stats;
+
+  // writing through the History would desync the sums and queues
+  static_assert(!std::is_convertible<WindowedStats<int, 4> *, History<int, 4> *>::value,
+                "WindowedStats mustn't be usable as a History");
+
+  for (int x : {1, 2, 3, 4, 5}) stats += x;
+  EXPECT_EQ(4u, stats.count());
+  EXPECT_EQ(5, stats[0]);
+  EXPECT_EQ(2, stats[3]);
+}
+
+TEST(WindowedStatsTest, TestFloatVarianceNotNegative) {
+  WindowedStats<float, 8> stats;
+
+  // rounding left over from large samples cancels against a constant window
+  srand(18);
+  for (int i=0; i < 10000; ++i) {
+    stats += (i/50) % 2 ? 3.3f : (rand() % 1000000)*1.37f + 0.1f;
+    ASSERT_GE(stats.variance(), 0);
+  }
+}
+
+TEST(WindowedStatsTest, TestExactIntegerMoments) {
+  WindowedStats<int16_t, 4> stats;
+
+  for (int16_t x : {30000, 30000, -30000, -30000, 2, 4, 6, 8}) stats += x;
+
+  EXPECT_EQ(20, stats.total());
+  EXPECT_EQ(5, stats.mean());
+  EXPECT_EQ(5, stats.variance()); // (4+16+36+64)/4 - 25
+  EXPECT_EQ(8, stats.max());
+  EXPECT_EQ(2, stats.min());
+}
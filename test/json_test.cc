@@ -176,6 +176,23 @@ public:
 
     return done && !error && replay.succeeded();
   }
+
+  // feeds the text to the reader piece bytes at a time
+  bool parse(const char *text, const char *check[], unsigned piece) {
+    ReplayVisitor replay;
+    unsigned len = strlen(text);
+
+    replay.set_tokens(check);
+    reader.reset(&replay);
+    for (unsigned i=0; i < len; i += piece) {
+      reader.read(text + i, len - i < piece ? len - i : piece);
+    }
+
+    bool done = reader.is_done();
+    bool error = reader.had_error();
+
+    return done && !error && replay.succeeded();
+  }
 };
 
 TEST_F(JSONTest, Parse1) {
@@ -228,6 +245,72 @@ TEST_F(JSONTest, ParseFloat1) {
   EXPECT_TRUE(parse("[1.0, 3.1415, -6, -3.0E12]", replay));
 }
 
+TEST_F(JSONTest, ParseLongStrings) {
+  static const char *replay[] = {
+    "{", "the quick brown fox jumps over the lazy dog", "[",
+    "0123456789abcdefghijklmnopqrstuvwxyz", "a\"quoted\" word\\", "x", "", "]", "}", 0
+  };
+  const char *text =
+    "{\"the quick brown fox jumps over the lazy dog\":"
+    "[\"0123456789abcdefghijklmnopqrstuvwxyz\", \"a\\\"quoted\\\" word\\\\\", \"x\", \"\"]}";
+
+  // every split lands somewhere different relative to the scan width
+  for (unsigned piece=1; piece <= 40; ++piece) {
+    EXPECT_TRUE(parse(text, replay, piece)) << piece;
+  }
+}
+
+TEST_F(JSONTest, ParseWhitespaceRuns) {
+  static const char *replay[] = {"{", "a", "1", "b", "[", "true", "2", "]", "}", 0};
+  const char *text =
+    "  \t\r\n  {\n    \"a\"  \t  :                                 1 ,\r\n"
+    "    \"b\":[true\n,\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n2]\n}                          \n";
+
+  for (unsigned piece=1; piece <= 40; ++piece) {
+    EXPECT_TRUE(parse(text, replay, piece)) << piece;
+  }
+}
+
+TEST_F(JSONTest, StringTooLong) {
+  char text[sizeof(token_buffer) + 8];
+
+  memset(text, 'x', sizeof(text));
+  text[0] = '[';
+  text[1] = '"';
+  text[sizeof(text) - 3] = '"';
+  text[sizeof(text) - 2] = ']';
+  text[sizeof(text) - 1] = 0;
+  EXPECT_FALSE(parse(text));
+
+  // the terminating nul has to fit too
+  text[sizeof(token_buffer) + 2] = '"';
+  text[sizeof(token_buffer) + 3] = ']';
+  text[sizeof(token_buffer) + 4] = 0;
+  EXPECT_FALSE(parse(text));
+
+  text[sizeof(token_buffer) + 1] = '"';
+  text[sizeof(token_buffer) + 2] = ']';
+  text[sizeof(token_buffer) + 3] = 0;
+  EXPECT_TRUE(parse(text));
+}
+
+TEST(JSONReaderTest, NestingDepth) {
+  char token_buffer[16];
+  Visitor visitor;
+  SizedReader<4> reader(token_buffer, sizeof(token_buffer));
+  const char *ok = "[[{\"a\" : []}]]", *too_deep = "[[{\"a\" : [[]]}]]";
+
+  reader.reset(&visitor);
+  reader.read(ok, strlen(ok));
+  EXPECT_TRUE(reader.is_done());
+  EXPECT_FALSE(reader.had_error());
+
+  // one level too deep
+  reader.reset(&visitor);
+  reader.read(too_deep, strlen(too_deep));
+  EXPECT_TRUE(reader.had_error());
+}
+
 TEST(JSONTestCase, WriteEmptyArray) {
   StringBufWriter sbw;
 
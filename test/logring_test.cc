@@ -0,0 +1,184 @@
+#include <akt/logring.h>
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace akt;
+
+class LogRingTest : public ::testing::Test {
+protected:
+  enum {STORAGE_SIZE = 64};
+  uint32_t storage[STORAGE_SIZE/4];
+
+  LogRingTest() :
+    ring(storage, STORAGE_SIZE)
+  {
+  }
+
+  LogRing ring;
+};
+
+TEST_F(LogRingTest, TestEmpty) {
+  size_t len;
+
+  EXPECT_EQ(64, ring.size());
+  EXPECT_EQ(28, ring.max_record());
+  EXPECT_TRUE(ring.empty());
+  EXPECT_EQ(0, ring.peek(len));
+}
+
+TEST_F(LogRingTest, TestWriteRead) {
+  const char *record;
+  size_t len;
+
+  ASSERT_TRUE(ring.write("hello", 5));
+  ASSERT_TRUE(ring.write("world!", 6));
+
+  record = ring.peek(len);
+  ASSERT_TRUE(record != 0);
+  EXPECT_EQ(5, len);
+  EXPECT_EQ(0, memcmp(record, "hello", 5));
+  ring.consume();
+
+  record = ring.peek(len);
+  ASSERT_TRUE(record != 0);
+  EXPECT_EQ(6, len);
+  EXPECT_EQ(0, memcmp(record, "world!", 6));
+  ring.consume();
+
+  EXPECT_EQ(0, ring.peek(len));
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST_F(LogRingTest, TestUncommittedBlocksLaterRecords) {
+  size_t len;
+
+  char *first = ring.claim(3);
+  ASSERT_TRUE(first != 0);
+  ASSERT_TRUE(ring.write("two", 3));
+
+  // the second record is complete but must wait for the first
+  EXPECT_EQ(0, ring.peek(len));
+
+  memcpy(first, "one", 3);
+  ring.commit(first, 3);
+
+  EXPECT_EQ(0, memcmp(ring.peek(len), "one", 3));
+  ring.consume();
+  EXPECT_EQ(0, memcmp(ring.peek(len), "two", 3));
+  ring.consume();
+}
+
+TEST_F(LogRingTest, TestCommitShorterThanClaim) {
+  size_t len;
+  char *record = ring.claim(20);
+
+  ASSERT_TRUE(record != 0);
+  int n = snprintf(record, 20, "%d", 12345);
+  ring.commit(record, n);
+
+  EXPECT_EQ(0, memcmp(ring.peek(len), "12345", 5));
+  EXPECT_EQ(5, len);
+}
+
+TEST_F(LogRingTest, TestFullAndTooLong) {
+  char text[32] = "abcdefghijklmnopqrstuvwxyz01234";
+
+  EXPECT_FALSE(ring.write(text, 29)); // longer than max_record()
+  EXPECT_TRUE(ring.write(text, 28));  // 32 bytes with header
+  EXPECT_TRUE(ring.write(text, 28));
+  EXPECT_FALSE(ring.write(text, 1));
+}
+
+TEST_F(LogRingTest, TestRecordsNeverWrap) {
+  const char *record;
+  size_t len;
+
+  for (int pass=0; pass < 20; ++pass) {
+    char text[16];
+    size_t n = snprintf(text, sizeof(text), "pass %d!", pass);
+
+    ASSERT_TRUE(ring.write(text, n));
+
+    record = ring.peek(len);
+    ASSERT_TRUE(record != 0);
+    ASSERT_EQ(n, len);
+    EXPECT_EQ(0, memcmp(record, text, n));
+
+    // every record is contiguous inside the storage
+    EXPECT_GE(record, (const char *) storage);
+    EXPECT_LE(record + len, (const char *) storage + STORAGE_SIZE);
+    ring.consume();
+  }
+}
+
+TEST_F(LogRingTest, TestUnalignedStorage) {
+  char raw[100];
+  LogRing odd(raw + 1, 99);
+  size_t len;
+
+  EXPECT_EQ(64, odd.size());
+  ASSERT_TRUE(odd.write("x", 1));
+  EXPECT_EQ('x', *odd.peek(len));
+}
+
+// Several producers write numbered records concurrently. The consumer
+// checks that every record arrives intact and that each producer's records
+// arrive in order with none missing.
+TEST(LogRingStressTest, TestMultipleProducers) {
+  enum {PRODUCERS = 4, RECORDS = 50000};
+  static uint32_t storage[256];
+  LogRing ring(storage, sizeof(storage));
+  std::vector<std::thread> producers;
+  unsigned expected[PRODUCERS] = {0};
+  unsigned errors = 0, received = 0;
+
+  for (unsigned p=0; p < PRODUCERS; ++p) {
+    producers.push_back(std::thread([&ring, p]() {
+      for (unsigned i=0; i < RECORDS; ) {
+        char text[32];
+        size_t n = snprintf(text, sizeof(text), "%u:%u:%u", p, i, p ^ i);
+
+        if (ring.write(text, n)) {
+          i += 1;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }));
+  }
+
+  while (received < PRODUCERS * RECORDS) {
+    const char *record;
+    size_t len;
+
+    if ((record = ring.peek(len)) == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    char text[32];
+    unsigned p, i, check;
+
+    memcpy(text, record, len);
+    text[len] = 0;
+
+    if (sscanf(text, "%u:%u:%u", &p, &i, &check) != 3 || p >= PRODUCERS ||
+        check != (p ^ i) || i != expected[p]) {
+      errors += 1;
+    } else {
+      expected[p] += 1;
+    }
+
+    ring.consume();
+    received += 1;
+  }
+
+  for (unsigned p=0; p < PRODUCERS; ++p) producers[p].join();
+
+  EXPECT_EQ(0, errors);
+  EXPECT_TRUE(ring.empty());
+}
@@ -0,0 +1,196 @@
+#include <akt/math.h>
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdlib>
+
+using namespace akt;
+
+namespace {
+  struct xyz {
+    int16_t x, y, z;
+  };
+
+  bool is_floor_sqrt(uint32_t a, uint32_t r) {
+    return (uint64_t) r*r <= a && (uint64_t) (r + 1)*(r + 1) > a;
+  }
+}
+
+TEST(MathTest, TestIsqrtExhaustiveLow) {
+  for (uint32_t a=0; a < (1u << 24); ++a) {
+    ASSERT_TRUE(is_floor_sqrt(a, isqrt(a))) << a;
+  }
+}
+
+// Errors show up next to perfect squares, so all of those are tried
+TEST(MathTest, TestIsqrtSquares) {
+  for (uint32_t r=1; r < 65536; ++r) {
+    uint32_t square = r*r;
+
+    ASSERT_EQ(r, isqrt(square));
+    ASSERT_EQ(r - 1, isqrt(square - 1));
+    ASSERT_EQ(r, isqrt(square + 1));
+    ASSERT_EQ(r, isqrt(square + 2*r)); // (r+1)^2 - 1
+  }
+
+  EXPECT_EQ(65535, isqrt(0xffffffff));
+}
+
+TEST(MathTest, TestRsqrt) {
+  double worst = 0;
+
+  for (uint32_t a=1; a < (1u << 20); ++a) {
+    double exact = 2147483648.0 / sqrt((double) a);
+    worst = std::max(worst, fabs(rsqrt(a) - exact) / exact);
+  }
+
+  srand(24);
+  for (unsigned i=0; i < 1000000; ++i) {
+    uint32_t a = ((uint32_t) rand() << 16 ^ rand()) | 1;
+    double exact = 2147483648.0 / sqrt((double) a);
+    worst = std::max(worst, fabs(rsqrt(a) - exact) / std::max(exact, 1.0));
+  }
+
+  EXPECT_LT(worst, 2e-9 + 1.0 / 32768); // the result has 15 bits at the top of the range
+  EXPECT_EQ(1u << 31, rsqrt(1));
+  EXPECT_EQ(1u << 30, rsqrt(4));
+  EXPECT_EQ(0xffffffff, rsqrt(0));
+}
+
+TEST(MathTest, TestRsqrtRelativeError) {
+  // where the result has plenty of bits, it's good to a few parts per billion
+  for (uint32_t a=1; a < 4096; ++a) {
+    double exact = 2147483648.0 / sqrt((double) a);
+    ASSERT_NEAR(exact, rsqrt(a), 4e-9 * exact + 1) << a;
+  }
+}
+
+TEST(MathTest, TestRsqrtQ16_16) {
+  for (float x : {0.25f, 1.0f, 2.0f, 100.0f, 1000.5f}) {
+    EXPECT_NEAR(1/sqrt(x), rsqrt(Q16_16(x)).to_float(), 2.0 / 65536) << x;
+  }
+
+  EXPECT_EQ(Q16_16::max(), rsqrt(Q16_16()));
+  EXPECT_EQ(Q16_16::max(), rsqrt(Q16_16(-1)));
+}
+
+TEST(MathTest, TestAtan2Exhaustive) {
+  const double lsb = M_PI / 32768;
+  double worst = 0;
+
+  for (int y=-300; y <= 300; ++y) {
+    for (int x=-300; x <= 300; ++x) {
+      if (x == 0 && y == 0) continue;
+
+      double exact = atan2((double) y, (double) x), estimate = akt::atan2(y, x).raw() * lsb;
+      double error = fabs(estimate - exact);
+
+      if (error > M_PI) error = 2*M_PI - error; // +pi and -pi are the same angle
+      worst = std::max(worst, error);
+    }
+  }
+
+  EXPECT_LE(worst, 0.65 * lsb); // rounding to Q15 plus the polynomial's error
+}
+
+TEST(MathTest, TestAtan2Axes) {
+  EXPECT_EQ(0, akt::atan2(0, 0).raw());
+  EXPECT_EQ(0, akt::atan2(0, 5).raw());
+  EXPECT_EQ(16384, akt::atan2(5, 0).raw());
+  EXPECT_EQ(-16384, akt::atan2(-5, 0).raw());
+  EXPECT_EQ(-32768, akt::atan2(0, -5).raw());
+  EXPECT_EQ(8192, akt::atan2(7, 7).raw());
+  EXPECT_EQ(-24576, akt::atan2(-7, -7).raw());
+  EXPECT_EQ(16384, akt::atan2(INT32_MAX, 0).raw());
+  EXPECT_EQ(-16384, akt::atan2(INT32_MIN, 0).raw());
+}
+
+TEST(MathTest, TestMagnitudeAndNormalize) {
+  srand(25);
+
+  for (unsigned i=0; i < 200000; ++i) {
+    xyz v = {(int16_t) rand(), (int16_t) rand(), (int16_t) rand()};
+    double length = sqrt((double) v.x*v.x + (double) v.y*v.y + (double) v.z*v.z);
+
+    ASSERT_EQ((uint16_t) floor(length), magnitude(v));
+    if (length == 0) continue;
+
+    Q15 x, y, z;
+    normalize(v, x, y, z);
+    ASSERT_NEAR(std::min(v.x / length, 32767 / 32768.0), x.to_float(), 2.0 / 32768);
+    ASSERT_NEAR(std::min(v.y / length, 32767 / 32768.0), y.to_float(), 2.0 / 32768);
+    ASSERT_NEAR(std::min(v.z / length, 32767 / 32768.0), z.to_float(), 2.0 / 32768);
+  }
+
+  xyz full = {-32768, -32768, -32768}, axis = {0, 0, -32768}, zero = {0, 0, 0};
+  Q15 x, y, z;
+
+  EXPECT_EQ(56755, magnitude(full));
+  EXPECT_EQ(5, magnitude(3, -4));
+
+  normalize(axis, x, y, z);
+  EXPECT_EQ(0, x.raw());
+  EXPECT_EQ(-32768, z.raw());
+
+  normalize(zero, x, y, z);
+  EXPECT_EQ(0, z.raw());
+}
+
+TEST(FixedTest, TestSaturatingArithmetic) {
+  Q15 half(0.5f), max = Q15::max(), min = Q15::min();
+
+  EXPECT_EQ(16384, half.raw());
+  EXPECT_EQ(max, half + half);
+  EXPECT_EQ(max, max + half);
+  EXPECT_EQ(min, min - half);
+  EXPECT_EQ(max, -min);
+  EXPECT_EQ(Q15(0.25f), half * half);
+  EXPECT_EQ(Q15::from_raw(-32767), min * max);
+  EXPECT_EQ(max, min * min); // 1.0 doesn't fit
+  EXPECT_EQ(half, Q15(0.25f) / half);
+  EXPECT_EQ(max, half / Q15(0.25f));
+  EXPECT_EQ(max, half / Q15());
+  EXPECT_EQ(min, -half / Q15());
+  EXPECT_EQ(max, Q15(3.0f));
+  EXPECT_EQ(min, Q15(-3.0f));
+}
+
+TEST(FixedTest, TestQ16_16) {
+  Q16_16 a(3), b(-2.5f);
+
+  EXPECT_EQ(3 << 16, a.raw());
+  EXPECT_FLOAT_EQ(0.5f, (a + b).to_float());
+  EXPECT_FLOAT_EQ(-7.5f, (a * b).to_float());
+  EXPECT_NEAR(-1.2f, (a / b).to_float(), 1.0 / 65536);
+  EXPECT_EQ(Q16_16::max(), Q16_16(30000) + Q16_16(30000));
+  EXPECT_EQ(Q16_16::min(), Q16_16(300) * Q16_16(-300));
+  EXPECT_EQ(Q16_16::max(), Q16_16(100000));
+  EXPECT_EQ(Q16_16::min(), Q16_16(-100000));
+  EXPECT_EQ(-3 * 65536, Q16_16(-3).raw());
+  EXPECT_EQ(Q15::min(), Q15(-1));
+  EXPECT_EQ(Q15::min(), Q15(-100000));
+  EXPECT_TRUE(b < a);
+
+  Q16_16 c = a;
+  c *= a;
+  c -= Q16_16(1);
+  c /= Q16_16(2);
+  EXPECT_EQ(Q16_16(4), c);
+}
+
+// rounding of products and quotients, checked against doubles
+TEST(FixedTest, TestQ15Exhaustive) {
+  for (int a=-32768; a < 32768; a += 7) {
+    for (int b=-32768; b < 32768; b += 251) {
+      double exact = (double) a * b / 32768;
+      ASSERT_NEAR(std::max(-32768.0, std::min(32767.0, exact)),
+                  (Q15::from_raw(a) * Q15::from_raw(b)).raw(), 0.5) << a << " * " << b;
+
+      if (b != 0) {
+        double q = (double) a * 32768 / b;
+        ASSERT_NEAR(std::max(-32768.0, std::min(32767.0, q)),
+                    (Q15::from_raw(a) / Q15::from_raw(b)).raw(), 0.5) << a << " / " << b;
+      }
+    }
+  }
+}
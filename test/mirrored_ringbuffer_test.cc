@@ -0,0 +1,120 @@
+#include <akt/mirrored_ringbuffer.h>
+#include <akt/json/reader.h>
+#include <akt/json/visitor.h>
+
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace akt;
+
+class MirroredRingBufferTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    ASSERT_TRUE(ring.allocate(1));
+  }
+
+  MirroredRingBuffer<char> ring;
+};
+
+TEST_F(MirroredRingBufferTest, TestAllocate) {
+  EXPECT_TRUE(ring.allocated());
+  EXPECT_EQ((size_t) sysconf(_SC_PAGESIZE), ring.size());
+  EXPECT_EQ(ring.size(), ring.write_capacity());
+
+  MirroredRingBuffer<uint32_t> big;
+  ASSERT_TRUE(big.allocate(10000));
+  EXPECT_GE(big.size(), 10000);
+  big.release();
+  EXPECT_FALSE(big.allocated());
+}
+
+TEST_F(MirroredRingBufferTest, TestAllocateTooLarge) {
+  MirroredRingBuffer<uint32_t> big;
+
+  // min_capacity * sizeof(T) used to wrap to 0 and allocate a single page
+  EXPECT_FALSE(big.allocate(SIZE_MAX / sizeof(uint32_t) + 1));
+  EXPECT_FALSE(big.allocated());
+  EXPECT_FALSE(big.allocate(SIZE_MAX));
+  EXPECT_FALSE(ring.allocate(SIZE_MAX / 2 + 1));
+  EXPECT_FALSE(ring.allocated());
+
+  ASSERT_TRUE(big.allocate(1));
+  EXPECT_EQ((size_t) sysconf(_SC_PAGESIZE) / sizeof(uint32_t), big.size());
+}
+
+TEST_F(MirroredRingBufferTest, TestSpansAreAlwaysContiguous) {
+  const size_t size = ring.size();
+  char block[100];
+
+  for (size_t i=0; i < sizeof(block); ++i) block[i] = (char) i;
+
+  // walk the read position all the way around, so that every
+  // possible split point is crossed at least once
+  for (size_t pass=0; pass < size + 10; ++pass) {
+    ASSERT_EQ(sizeof(block), ring.write(block, sizeof(block)));
+    EXPECT_EQ(ring.read_capacity(), ring.contiguous_read_capacity());
+
+    RingSpans<char> spans = ring.peek_read();
+    ASSERT_EQ(sizeof(block), spans.first.length);
+    EXPECT_EQ(0, spans.second.length);
+    ASSERT_EQ(0, memcmp(spans.first.data, block, sizeof(block)));
+
+    ring.consume(sizeof(block) - 1); // keeps the split point moving
+    ring.skip(1);
+  }
+}
+
+TEST_F(MirroredRingBufferTest, TestFullCapacity) {
+  const size_t size = ring.size();
+
+  ASSERT_EQ(size/2, ring.reserve_write(size/2).length());
+  ring.commit_write(size/2);
+  ring.consume(size/2);
+
+  RingSpans<char> spans = ring.reserve_write(size);
+  ASSERT_EQ(size, spans.first.length);
+  EXPECT_EQ(0, spans.second.length);
+  memset(spans.first.data, 'x', size);
+  ring.commit_write(size);
+
+  EXPECT_EQ(0, ring.write_capacity());
+  EXPECT_EQ('x', ring.peek(0));
+  EXPECT_EQ('x', ring.peek(size-1));
+}
+
+namespace {
+  class CountingVisitor : public json::Visitor {
+  public:
+    unsigned ints, strings;
+    CountingVisitor() : ints(0), strings(0) {}
+    virtual void num_int(int32_t n) override { ints += 1; }
+    virtual void string(const char *text) override { strings += 1; }
+  };
+}
+
+// Documents straddle the end of the storage, yet each one reaches the
+// parser as a single chunk.
+TEST_F(MirroredRingBufferTest, TestJSONReaderGetsOneChunk) {
+  const char *doc = "{\"a\":[1,2,3],\"b\":\"hello\",\"c\":[\"x\",\"y\"]}";
+  const size_t len = strlen(doc);
+  char token_buffer[32];
+  json::Reader reader(token_buffer, sizeof(token_buffer));
+
+  for (unsigned i=0; i < 500; ++i) {
+    CountingVisitor visitor;
+
+    ASSERT_EQ(len, ring.write(doc, len));
+
+    RingSpans<char> spans = ring.peek_read();
+    ASSERT_EQ(len, spans.first.length);
+
+    reader.reset(&visitor);
+    reader.read(spans.first.data, spans.first.length);
+    ring.consume(spans.first.length);
+
+    ASSERT_TRUE(reader.is_done());
+    ASSERT_FALSE(reader.had_error());
+    EXPECT_EQ(3, visitor.ints);
+    EXPECT_EQ(3, visitor.strings);
+  }
+}
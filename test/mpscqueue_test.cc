@@ -0,0 +1,208 @@
+#include <akt/mpscqueue.h>
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace akt;
+
+namespace {
+  struct Node : public Ring<Node> {
+    unsigned producer, sequence;
+  };
+}
+
+TEST(MPSCQueueTest, TestEmpty) {
+  MPSCQueue<Node> queue;
+
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(0, queue.pop());
+}
+
+TEST(MPSCQueueTest, TestFIFO) {
+  MPSCQueue<Node> queue;
+  Node nodes[5];
+
+  for (unsigned i=0; i < 5; ++i) {
+    nodes[i].sequence = i;
+    queue.push(&nodes[i]);
+    EXPECT_FALSE(queue.empty());
+  }
+
+  for (unsigned i=0; i < 5; ++i) {
+    Node *n = queue.pop();
+    ASSERT_EQ(&nodes[i], n);
+  }
+
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(0, queue.pop());
+}
+
+TEST(MPSCQueueTest, TestPoppedNodesAreSingletons) {
+  MPSCQueue<Node> queue;
+  Ring<Node> ring;
+  Node a, b;
+
+  queue.push(&a);
+  queue.push(&b);
+  Node *n = queue.pop();
+
+  // a popped node can go straight back into a Ring
+  ASSERT_EQ(&a, n);
+  n->join(&ring);
+  EXPECT_EQ(&a, ring.begin());
+
+  // and, once out of it again, back into the queue
+  a.join(&a);
+  queue.push(&a);
+  EXPECT_EQ(&b, queue.pop());
+  EXPECT_EQ(&a, queue.pop());
+  EXPECT_EQ(0, queue.pop());
+}
+
+TEST(MPSCQueueTest, TestInterleaved) {
+  MPSCQueue<Node> queue;
+  Node nodes[3];
+
+  // the queue drains completely and refills several times, which moves
+  // the stub node in and out of the chain
+  for (int pass=0; pass < 4; ++pass) {
+    queue.push(&nodes[0]);
+    EXPECT_EQ(&nodes[0], queue.pop());
+    queue.push(&nodes[1]);
+    queue.push(&nodes[2]);
+    EXPECT_EQ(&nodes[1], queue.pop());
+    queue.push(&nodes[0]);
+    EXPECT_EQ(&nodes[2], queue.pop());
+    EXPECT_EQ(&nodes[0], queue.pop());
+    EXPECT_EQ(0, queue.pop());
+  }
+}
+
+namespace {
+  // pushes in two steps, to stop a producer in the middle
+  struct SteppedQueue : public MPSCQueue<Node> {
+    RingBase *begin_push(Node *n) {return swap_head((Ring<Node> *) n);}
+    void end_push(RingBase *prev, Node *n) {link(prev, (Ring<Node> *) n);}
+  };
+}
+
+// The consumer finds nothing, then a producer links its node and sees the
+// consumer still busy before the consumer lets go. The node mustn't be
+// left in the queue with nobody to take it.
+TEST(MPSCQueueTest, TestReleaseSeesLatePush) {
+  SteppedQueue queue;
+  std::atomic<bool> busy(true);
+  Node a;
+
+  RingBase *prev = queue.begin_push(&a);
+  EXPECT_EQ(0, queue.pop());
+  queue.end_push(prev, &a);
+  EXPECT_TRUE(busy.exchange(true)); // the producer leaves it to the consumer
+
+  EXPECT_EQ(&a, queue.release(busy));
+  EXPECT_TRUE(busy);
+  EXPECT_EQ(0, queue.pop_or_release(busy));
+  EXPECT_FALSE(busy);
+}
+
+// A push still in progress is left to its producer, which finds busy clear.
+TEST(MPSCQueueTest, TestReleaseLeavesPushInProgress) {
+  SteppedQueue queue;
+  std::atomic<bool> busy(true);
+  Node a;
+
+  RingBase *prev = queue.begin_push(&a);
+  EXPECT_EQ(0, queue.pop_or_release(busy));
+  EXPECT_FALSE(busy);
+
+  queue.end_push(prev, &a);
+  EXPECT_FALSE(busy.exchange(true));
+  EXPECT_EQ(&a, queue.pop_or_release(busy));
+}
+
+// Senders hand off like H4: whoever claims busy "transmits" until the queue
+// is empty. Every node must be transmitted, and nothing left behind.
+TEST(MPSCQueueStressTest, TestClaimAndRelease) {
+  enum {PRODUCERS = 4, ROUNDS = 20000};
+  static Node nodes[PRODUCERS][ROUNDS];
+  MPSCQueue<Node> queue;
+  std::atomic<bool> busy(false);
+  std::atomic<unsigned> sent(0);
+  std::vector<std::thread> producers;
+
+  for (unsigned p=0; p < PRODUCERS; ++p) {
+    producers.push_back(std::thread([&, p]() {
+      for (unsigned i=0; i < ROUNDS; ++i) {
+        for (Node *n = queue.push_and_claim(&nodes[p][i], busy); n != 0; n = queue.pop_or_release(busy)) {
+          sent.fetch_add(1);
+          if (i % 64 == 0) std::this_thread::yield();
+        }
+      }
+    }));
+  }
+
+  for (unsigned p=0; p < PRODUCERS; ++p) producers[p].join();
+
+  EXPECT_EQ(PRODUCERS * ROUNDS, sent.load());
+  EXPECT_FALSE(busy);
+  EXPECT_TRUE(queue.empty());
+}
+
+// Producers push their own nodes, which the consumer hands back through a
+// per-producer "free" flag. Every node must come out exactly once and each
+// producer's nodes must come out in the order they were pushed.
+TEST(MPSCQueueStressTest, TestMultipleProducers) {
+  enum {PRODUCERS = 4, NODES = 64, ROUNDS = 20000};
+  static Node nodes[PRODUCERS][NODES];
+  static std::atomic<bool> in_use[PRODUCERS][NODES];
+  MPSCQueue<Node> queue;
+  std::vector<std::thread> producers;
+  unsigned expected[PRODUCERS] = {0};
+  unsigned errors = 0, received = 0;
+
+  for (unsigned p=0; p < PRODUCERS; ++p) {
+    for (unsigned i=0; i < NODES; ++i) in_use[p][i] = false;
+
+    producers.push_back(std::thread([&queue, p]() {
+      for (unsigned seq=0; seq < ROUNDS; ++seq) {
+        unsigned slot = seq % NODES;
+
+        while (in_use[p][slot].load(std::memory_order_acquire)) {
+          std::this_thread::yield(); // consumer hasn't returned it yet
+        }
+
+        Node &n = nodes[p][slot];
+        n.producer = p;
+        n.sequence = seq;
+        in_use[p][slot].store(true, std::memory_order_relaxed);
+        queue.push(&n);
+      }
+    }));
+  }
+
+  while (received < PRODUCERS * ROUNDS) {
+    Node *n = queue.pop();
+
+    if (n == 0) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    if (n->producer >= PRODUCERS || n->sequence != expected[n->producer]) {
+      errors += 1;
+    } else {
+      expected[n->producer] += 1;
+    }
+
+    received += 1;
+    in_use[n->producer][n->sequence % NODES].store(false, std::memory_order_release);
+  }
+
+  for (unsigned p=0; p < PRODUCERS; ++p) producers[p].join();
+
+  EXPECT_EQ(0, errors);
+  EXPECT_TRUE(queue.empty());
+  for (unsigned p=0; p < PRODUCERS; ++p) EXPECT_EQ(ROUNDS, expected[p]);
+}
@@ -0,0 +1,103 @@
+#include <akt/bluetooth/packet.h>
+
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace akt;
+using namespace akt::bluetooth;
+
+namespace {
+  typedef SlabPacketPool<SizeClass<32, 2>,
+                         SizeClass<64, 1>,
+                         SizeClass<256, 1> > TestPool;
+}
+
+TEST(SlabPacketPoolTest, TestMaxPacketSize) {
+  EXPECT_EQ(256, TestPool::MAX_PACKET_SIZE);
+}
+
+TEST(SlabPacketPoolTest, TestBestFit) {
+  TestPool pool;
+  Packet *p;
+
+  p = pool.allocate(1+4+27);
+  ASSERT_TRUE(p != 0);
+  EXPECT_EQ(32, p->capacity());
+  p->deallocate();
+
+  p = pool.allocate(33);
+  ASSERT_TRUE(p != 0);
+  EXPECT_EQ(64, p->capacity());
+  p->deallocate();
+
+  p = pool.allocate(1+4+251);
+  ASSERT_TRUE(p != 0);
+  EXPECT_EQ(256, p->capacity());
+  p->deallocate();
+
+  EXPECT_EQ(0, pool.allocate(257));
+}
+
+TEST(SlabPacketPoolTest, TestFallsBackToLargerClass) {
+  TestPool pool;
+  Packet *small[2], *p;
+
+  small[0] = pool.allocate(10);
+  small[1] = pool.allocate(10);
+  ASSERT_TRUE(small[0] != 0 && small[1] != 0);
+
+  p = pool.allocate(10);
+  ASSERT_TRUE(p != 0);
+  EXPECT_EQ(64, p->capacity());
+
+  Packet *q = pool.allocate(10);
+  ASSERT_TRUE(q != 0);
+  EXPECT_EQ(256, q->capacity());
+
+  EXPECT_EQ(0, pool.allocate(10));
+
+  // packets go back to their own class
+  small[0]->deallocate();
+  p = pool.allocate(10);
+  EXPECT_EQ(small[0], p);
+}
+
+TEST(SlabPacketPoolTest, TestFallbackIsNotAFailure) {
+  TestPool pool("slab fallback");
+  uint32_t failures = 0;
+
+  while (pool.allocate(10) != 0) {}
+
+  for (Ring<PoolStats>::Iterator i=PoolStats::registry.begin(); i != PoolStats::registry.end(); ++i) {
+    if (!strcmp(i->name ? i->name : "", "slab fallback")) failures += i->failures();
+  }
+
+  // only the allocation that found nothing in any class
+  EXPECT_EQ(1, failures);
+}
+
+TEST(SlabPacketPoolTest, TestReset) {
+  TestPool pool;
+
+  while (pool.allocate(1) != 0) {}
+  pool.reset();
+
+  for (int i=0; i < 4; ++i) EXPECT_TRUE(pool.allocate(1) != 0);
+  EXPECT_EQ(0, pool.allocate(1));
+}
+
+TEST(BitmapPacketPoolTest, TestDeallocate) {
+  BitmapPacketPool<64, 2> pool;
+  Ring<Packet> queue;
+
+  Packet *p = pool.allocate();
+  ASSERT_TRUE(p != 0);
+  EXPECT_EQ(64, p->capacity());
+  p->join(&queue);
+
+  // the packet leaves the queue on its way back to the pool
+  p->deallocate();
+  EXPECT_EQ(queue.end(), queue.begin());
+  EXPECT_FALSE(pool.allocated((SizedPacket<64> *) p));
+  EXPECT_EQ(p, pool.allocate());
+}
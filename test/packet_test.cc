@@ -0,0 +1,128 @@
+#include <akt/bluetooth/packet.h>
+
+#include <gtest/gtest.h>
+
+using namespace akt;
+using namespace akt::bluetooth;
+
+TEST(PacketTest, TestReserveMatchesOperators) {
+  SizedPacket<16> checked, reserved;
+  uint8_t bytes[3] = {7, 8, 9};
+
+  checked << (uint8_t) 0x12 << (uint16_t) 0x3456 << (uint32_t) 0x789abcde;
+  checked.write(bytes, sizeof(bytes));
+
+  (reserved.reserve(1+2+4+3) << (uint8_t) 0x12 << (uint16_t) 0x3456 << (uint32_t) 0x789abcde)
+    .write(bytes, sizeof(bytes));
+
+  EXPECT_EQ(checked.position(), reserved.position());
+  checked.flip();
+  reserved.flip();
+  EXPECT_EQ(0, memcmp((uint8_t *) checked, (uint8_t *) reserved, 10));
+}
+
+TEST(PacketTest, TestReserveRead) {
+  SizedPacket<16> p;
+  uint8_t a;
+  uint16_t b;
+  uint32_t c;
+  uint8_t bytes[2];
+
+  p << (uint8_t) 0xfe << (uint16_t) 0xbeef << (uint32_t) 0xdeadbeef << (uint8_t) 1 << (uint8_t) 2;
+  p.flip();
+
+  ByteCursor cursor = p.reserve(1+2+4);
+  cursor >> a >> b >> c;
+  p.reserve(2) >> bytes[0] >> bytes[1];
+
+  EXPECT_EQ(0xfe, a);
+  EXPECT_EQ(0xbeef, b);
+  EXPECT_EQ(0xdeadbeef, c);
+  EXPECT_EQ(1, bytes[0]);
+  EXPECT_EQ(2, bytes[1]);
+  EXPECT_EQ(0, p.remaining());
+}
+
+TEST(PacketTest, TestSegmentsCountInLengths) {
+  SizedPacket<16> p;
+  uint8_t value[40], more[3];
+  PacketSegment a(value, sizeof(value)), b(more, sizeof(more));
+
+  p.l2cap(0x0040, 0x0004) << (uint8_t) 0x0b; // ATT read response
+  p.append(a).append(b);
+  EXPECT_EQ(sizeof(value) + sizeof(more), p.segment_length());
+
+  p.prepare_for_tx();
+  EXPECT_EQ(10, p.remaining()); // only the framing is in the packet
+
+  uint16_t acl_length, l2cap_length;
+  p.seek(3);
+  p >> acl_length >> l2cap_length;
+  EXPECT_EQ(4 + 1 + 43, acl_length);
+  EXPECT_EQ(1 + 43, l2cap_length);
+}
+
+TEST(PacketTest, TestAppendOrderAndReset) {
+  SizedPacket<16> p;
+  uint8_t bytes[6];
+  PacketSegment a(bytes, 1), b(bytes + 1, 2), c(bytes + 3, 3);
+
+  c.next = &a; // stale links from an earlier chain are dropped
+  p.append(a).append(b).append(c);
+
+  EXPECT_EQ(&a, p.segments);
+  EXPECT_EQ(&b, a.next);
+  EXPECT_EQ(&c, b.next);
+  EXPECT_EQ(0, c.next);
+
+  p.reset();
+  EXPECT_EQ(0, p.segments);
+  EXPECT_EQ(0, p.segment_length());
+}
+
+TEST(PacketTest, TestPoolsDropSegments) {
+  PacketPool<16, 1> pool;
+  PacketSegment s;
+
+  Packet *p = pool.allocate();
+  p->append(s);
+  p->deallocate();
+
+  p = pool.allocate();
+  ASSERT_TRUE(p != 0);
+  EXPECT_EQ(0, p->segments);
+}
+
+TEST(PacketTest, TestShortValueReadIsOneSegment) {
+  enum {ATT_MTU = 23, READ_RSP = 0x0b, COPY_LIMIT = 32};
+  SizedPacket<32> p; // the slab class a read request arrives in
+  PacketSegment s;
+  uint8_t value[ATT_MTU - 1];
+
+  for (unsigned i=0; i < sizeof(value); ++i) value[i] = i;
+
+  p.l2cap(p.l2cap_limit(ATT_MTU)) << (uint8_t) READ_RSP;
+  const uint8_t *copy = p;
+  p.write_or_append(s, value, 20, COPY_LIMIT);
+
+  EXPECT_EQ(0, p.segments);
+  EXPECT_EQ(Packet::L2CAP_HEADER_SIZE + 1 + 20, p.position());
+  EXPECT_EQ(0, memcmp(value, copy, 20));
+
+  // a value filling the rest of the ATT_MTU still fits
+  p.l2cap(p.l2cap_limit(ATT_MTU)) << (uint8_t) READ_RSP;
+  p.write_or_append(s, value, sizeof(value), COPY_LIMIT);
+  EXPECT_EQ(0, p.segments);
+  EXPECT_EQ(0u, p.remaining());
+
+  // and one that doesn't fit is chained
+  p.write_or_append(s, value, 1, COPY_LIMIT);
+  EXPECT_EQ(&s, p.segments);
+}
+
+TEST(PacketTest, TestL2CAPLimitStaysWithinCapacity) {
+  SizedPacket<16> p;
+
+  EXPECT_EQ(16, p.l2cap_limit(23));
+  EXPECT_EQ(Packet::L2CAP_HEADER_SIZE + 4, p.l2cap_limit(4));
+}
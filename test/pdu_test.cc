@@ -0,0 +1,62 @@
+#include <akt/bluetooth/pdu.h>
+
+#include <gtest/gtest.h>
+
+using namespace akt;
+using namespace akt::bluetooth;
+
+TEST(PDUTest, TestLayoutsArePacked) {
+  EXPECT_EQ(18, sizeof(HCI::LEConnectionComplete));
+  EXPECT_EQ(1, alignof(HCI::LEConnectionComplete));
+  EXPECT_EQ(5, sizeof(ATT::ReadByTypeRequest));
+}
+
+TEST(PDUTest, TestReadView) {
+  const uint8_t bytes[18] = {
+    0x00,                               // status
+    0x40, 0x00,                         // connection handle
+    0x01,                               // role
+    0x01,                               // peer address type
+    0x11, 0x22, 0x33, 0x44, 0x55, 0x66, // peer address
+    0x28, 0x00,                         // interval
+    0x02, 0x00,                         // latency
+    0xc8, 0x01,                         // supervision timeout
+    0x05                                // clock accuracy
+  };
+  SizedPacket<20> p;
+
+  p.write(bytes, sizeof(bytes));
+  p.flip();
+
+  const HCI::LEConnectionComplete &e = pdu<HCI::LEConnectionComplete>(p);
+
+  EXPECT_EQ(0, e.status);
+  EXPECT_EQ(0x0040, e.connection_handle);
+  EXPECT_EQ(1, e.role);
+  EXPECT_EQ(0x66, e.peer_address[5]);
+  EXPECT_EQ(0x0028, e.conn_interval);
+  EXPECT_EQ(0x0002, e.conn_latency);
+  EXPECT_EQ(0x01c8, e.supervision_timeout);
+  EXPECT_EQ(5, e.master_clock_accuracy);
+  EXPECT_EQ(0, p.remaining());
+}
+
+TEST(PDUTest, TestWriteViewMatchesOperators) {
+  SizedPacket<32> checked, viewed;
+
+  checked.l2cap(0x0040, L2CAP::ATTRIBUTE_CID) << (uint8_t) ATT::OPCODE_ERROR
+                                               << (uint8_t) ATT::OPCODE_READ_REQUEST
+                                               << (uint16_t) 0x1234
+                                               << (uint8_t) ATT::INVALID_HANDLE;
+
+  ATT::ErrorResponse &e = pdu<ATT::ErrorResponse>(viewed.l2cap(0x0040, L2CAP::ATTRIBUTE_CID));
+  e.code = ATT::OPCODE_ERROR;
+  e.request_opcode = ATT::OPCODE_READ_REQUEST;
+  e.handle = 0x1234;
+  e.error_code = ATT::INVALID_HANDLE;
+
+  ASSERT_EQ(checked.position(), viewed.position());
+  checked.flip();
+  viewed.flip();
+  EXPECT_EQ(0, memcmp((uint8_t *) checked, (uint8_t *) viewed, checked.remaining()));
+}
@@ -0,0 +1,198 @@
+#include <akt/pool.h>
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace akt;
+
+namespace {
+  struct Item : public Ring<Item> {
+    int resets;
+    std::atomic<int> users;
+
+    Item() : resets(0), users(0) {}
+    void reset() { resets += 1; }
+  };
+}
+
+template<class P>
+class PoolTest : public ::testing::Test {
+protected:
+  P pool;
+};
+
+typedef ::testing::Types<Pool<Item, 4>, LockFreePool<Item, 4>, BitmapPool<Item, 4> > PoolTypes;
+TYPED_TEST_CASE(PoolTest, PoolTypes);
+
+TYPED_TEST(PoolTest, TestExhaust) {
+  Item *items[4];
+
+  EXPECT_EQ(4, this->pool.capacity);
+
+  for (int i=0; i < 4; ++i) {
+    items[i] = this->pool.allocate();
+    ASSERT_TRUE(items[i] != 0);
+    EXPECT_GE(items[i]->resets, 1);
+
+    for (int j=0; j < i; ++j) EXPECT_NE(items[i], items[j]);
+  }
+
+  EXPECT_EQ(0, this->pool.allocate());
+
+  this->pool.deallocate(items[2]);
+  EXPECT_EQ(items[2], this->pool.allocate());
+  EXPECT_EQ(0, this->pool.allocate());
+}
+
+TYPED_TEST(PoolTest, TestReset) {
+  for (int i=0; i < 4; ++i) ASSERT_TRUE(this->pool.allocate() != 0);
+  EXPECT_EQ(0, this->pool.allocate());
+
+  this->pool.reset();
+  for (int i=0; i < 4; ++i) ASSERT_TRUE(this->pool.allocate() != 0);
+}
+
+TYPED_TEST(PoolTest, TestStats) {
+  PoolStats &stats = this->pool.stats;
+  Item *items[4];
+
+  EXPECT_EQ(4, stats.capacity);
+  EXPECT_EQ(0, stats.in_use());
+  EXPECT_EQ(4, stats.min_free());
+
+  for (int i=0; i < 3; ++i) items[i] = this->pool.allocate();
+  EXPECT_EQ(3, stats.in_use());
+
+  this->pool.deallocate(items[0]);
+  this->pool.deallocate(items[1]);
+  EXPECT_EQ(1, stats.in_use());
+  EXPECT_EQ(3, stats.peak_in_use());
+  EXPECT_EQ(1, stats.min_free());
+
+  for (int i=0; i < 4; ++i) items[i] = this->pool.allocate();
+  EXPECT_EQ(0, items[3]);
+  EXPECT_EQ(4, stats.peak_in_use());
+  EXPECT_EQ(0, stats.min_free());
+  EXPECT_EQ(6, stats.allocations());
+  EXPECT_EQ(1, stats.failures());
+}
+
+TEST(BitmapPoolTest, TestLowestAddressFirst) {
+  BitmapPool<Item, 40> pool;
+  Item *items[40];
+
+  for (int i=0; i < 40; ++i) {
+    items[i] = pool.allocate();
+    ASSERT_TRUE(items[i] != 0);
+    if (i > 0) {
+      EXPECT_EQ(items[i-1] + 1, items[i]);
+    }
+  }
+
+  EXPECT_EQ(0, pool.allocate());
+
+  pool.deallocate(items[35]);
+  pool.deallocate(items[3]);
+  pool.deallocate(items[33]);
+
+  EXPECT_EQ(items[3], pool.allocate());
+  EXPECT_EQ(items[33], pool.allocate());
+  EXPECT_EQ(items[35], pool.allocate());
+  EXPECT_EQ(0, pool.allocate());
+}
+
+TEST(BitmapPoolTest, TestLargestPool) {
+  static BitmapPool<Item, 1024> pool;
+  static Item *items[1024];
+
+  for (int i=0; i < 1024; ++i) items[i] = pool.allocate();
+  EXPECT_EQ(items[0] + 1023, items[1023]);
+  EXPECT_EQ(0, pool.allocate());
+
+  // the summary word has to pick up words emptied and refilled out of order
+  for (int i : {1000, 31, 32, 640}) pool.deallocate(items[i]);
+  for (int i : {31, 32, 640, 1000}) EXPECT_EQ(items[i], pool.allocate());
+  EXPECT_EQ(0, pool.allocate());
+
+  pool.reset();
+  EXPECT_EQ(items[0], pool.allocate());
+}
+
+TEST(BitmapPoolTest, TestOwnsAndAllocated) {
+  BitmapPool<Item, 4> pool;
+  Item other;
+
+  Item *p = pool.allocate();
+  Item *q = pool.allocate();
+
+  EXPECT_TRUE(pool.owns(p));
+  EXPECT_FALSE(pool.owns(&other));
+  EXPECT_TRUE(pool.allocated(p));
+  EXPECT_FALSE(pool.allocated(&other));
+  EXPECT_FALSE(pool.allocated(q + 1));
+
+  pool.deallocate(p);
+  EXPECT_TRUE(pool.owns(p));
+  EXPECT_FALSE(pool.allocated(p)); // deallocating it again would assert
+  EXPECT_TRUE(pool.allocated(q));
+}
+
+TEST(PoolStatsTest, TestRegistry) {
+  Pool<Item, 2> *pool = new Pool<Item, 2>("test pool");
+  bool found = false;
+
+  for (Ring<PoolStats>::Iterator i=PoolStats::registry.begin(); i != PoolStats::registry.end(); ++i) {
+    if (i == &pool->stats) found = true;
+  }
+
+  EXPECT_TRUE(found);
+  EXPECT_STREQ("test pool", pool->stats.name);
+
+  delete pool;
+
+  for (Ring<PoolStats>::Iterator i=PoolStats::registry.begin(); i != PoolStats::registry.end(); ++i) {
+    EXPECT_NE(i, (PoolStats *) &pool->stats);
+  }
+}
+
+// Threads allocate and free as fast as they can. An object handed to two
+// threads at once shows up as more than one user.
+TEST(LockFreePoolStressTest, TestNoDoubleAllocation) {
+  enum {THREADS = 4, ROUNDS = 100000};
+  static LockFreePool<Item, 8> pool;
+  std::vector<std::thread> threads;
+  std::atomic<unsigned> errors(0);
+
+  for (unsigned t=0; t < THREADS; ++t) {
+    threads.push_back(std::thread([&errors]() {
+      Item *held[3];
+
+      for (unsigned round=0; round < ROUNDS; ++round) {
+        unsigned n = 0;
+
+        while (n < 3 && (held[n] = pool.allocate()) != 0) {
+          if (held[n]->users.fetch_add(1) != 0) errors += 1;
+          n += 1;
+        }
+
+        while (n > 0) {
+          n -= 1;
+          held[n]->users.fetch_sub(1);
+          pool.deallocate(held[n]);
+        }
+
+        if ((round & 0xff) == 0) std::this_thread::yield();
+      }
+    }));
+  }
+
+  for (unsigned t=0; t < THREADS; ++t) threads[t].join();
+
+  EXPECT_EQ(0, errors);
+
+  // every object must be back in the pool
+  for (int i=0; i < 8; ++i) EXPECT_TRUE(pool.allocate() != 0);
+  EXPECT_EQ(0, pool.allocate());
+}
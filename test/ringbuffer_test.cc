@@ -0,0 +1,330 @@
+#include <akt/ringbuffer.h>
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace akt;
+
+class RingBufferTest : public ::testing::Test {
+protected:
+  enum {CAPACITY = 16};
+  char storage[CAPACITY];
+
+  RingBufferTest() :
+    ring(storage, CAPACITY)
+  {
+  }
+
+  RingBuffer<char> ring;
+};
+
+TEST_F(RingBufferTest, TestEmpty) {
+  EXPECT_EQ(0, ring.read_capacity());
+  EXPECT_EQ(CAPACITY-1, ring.write_capacity());
+}
+
+TEST_F(RingBufferTest, TestFill) {
+  char src[CAPACITY], dst[CAPACITY];
+
+  for (int i=0; i < CAPACITY; ++i) src[i] = 'a' + i;
+
+  // one slot is always left empty
+  EXPECT_EQ(CAPACITY-1, ring.write(src, CAPACITY));
+  EXPECT_EQ(CAPACITY-1, ring.read_capacity());
+  EXPECT_EQ(0, ring.write_capacity());
+  EXPECT_EQ(0, ring.write(src, 1));
+
+  EXPECT_EQ(CAPACITY-1, ring.read(dst, CAPACITY));
+  EXPECT_EQ(0, memcmp(src, dst, CAPACITY-1));
+  EXPECT_EQ(0, ring.read_capacity());
+}
+
+TEST_F(RingBufferTest, TestWrap) {
+  char src[10], dst[10];
+
+  for (int i=0; i < 10; ++i) src[i] = '0' + i;
+
+  for (int pass=0; pass < 5; ++pass) {
+    ASSERT_EQ(10, ring.write(src, 10));
+    EXPECT_EQ('0', ring.peek(0));
+    EXPECT_EQ('9', ring.peek(9));
+    ASSERT_EQ(10, ring.read(dst, 10));
+    EXPECT_EQ(0, memcmp(src, dst, 10));
+  }
+}
+
+TEST_F(RingBufferTest, TestSkip) {
+  ASSERT_EQ(5, ring.write("hello", 5));
+  ring.skip(2);
+  EXPECT_EQ(3, ring.read_capacity());
+  EXPECT_EQ('l', ring.peek(0));
+  ring.skip(100);
+  EXPECT_EQ(0, ring.read_capacity());
+}
+
+TEST_F(RingBufferTest, TestReserveCommit) {
+  RingSpans<char> spans = ring.reserve_write(CAPACITY);
+
+  // empty ring at the start of storage: one contiguous span
+  EXPECT_EQ(storage, spans.first.data);
+  EXPECT_EQ(CAPACITY-1, spans.first.length);
+  EXPECT_EQ(0, spans.second.length);
+
+  memcpy(spans.first.data, "0123456789", 10);
+  ring.commit_write(10);
+  EXPECT_EQ(10, ring.read_capacity());
+
+  spans = ring.peek_read();
+  EXPECT_EQ(storage, spans.first.data);
+  EXPECT_EQ(10, spans.first.length);
+  EXPECT_EQ(0, spans.second.length);
+  ring.consume(8);
+
+  // free space now wraps around the end of storage
+  spans = ring.reserve_write(100);
+  EXPECT_EQ(storage+10, spans.first.data);
+  EXPECT_EQ(CAPACITY-10, spans.first.length);
+  EXPECT_EQ(storage, spans.second.data);
+  EXPECT_EQ(7, spans.second.length);
+  EXPECT_EQ(ring.write_capacity(), spans.length());
+
+  spans = ring.reserve_write(8);
+  EXPECT_EQ(6, spans.first.length);
+  EXPECT_EQ(2, spans.second.length);
+  memcpy(spans.first.data, "abcdef", 6);
+  memcpy(spans.second.data, "gh", 2);
+  ring.commit_write(8);
+
+  spans = ring.peek_read();
+  EXPECT_EQ(8, spans.first.length);
+  EXPECT_EQ(2, spans.second.length);
+  EXPECT_EQ(0, memcmp(spans.first.data, "89abcdef", 8));
+  EXPECT_EQ(0, memcmp(spans.second.data, "gh", 2));
+
+  ring.consume(spans.length());
+  EXPECT_EQ(0, ring.read_capacity());
+}
+
+TEST_F(RingBufferTest, TestOverwrite) {
+  char dst[CAPACITY];
+
+  EXPECT_EQ(0, ring.overwrite("0123456789", 10));
+  EXPECT_EQ(5, ring.overwrite("abcdefghij", 10)); // 15 fit, 5 evicted
+  EXPECT_EQ(CAPACITY-1, ring.read_capacity());
+
+  ASSERT_EQ(CAPACITY-1, ring.read(dst, CAPACITY));
+  EXPECT_EQ(0, memcmp(dst, "56789abcdefghij", CAPACITY-1));
+
+  // more than the whole buffer: only the tail of src survives
+  EXPECT_EQ(5, ring.overwrite("ABCDEFGHIJKLMNOPQRST", 20));
+  ASSERT_EQ(CAPACITY-1, ring.read(dst, CAPACITY));
+  EXPECT_EQ(0, memcmp(dst, "FGHIJKLMNOPQRST", CAPACITY-1));
+}
+
+// records are framed by a leading length byte that includes itself
+static size_t framed_length(RingBuffer<char> &ring) {
+  return (size_t) ring.peek(0);
+}
+
+TEST_F(RingBufferTest, TestOverwriteRecords) {
+  char dst[CAPACITY];
+
+  EXPECT_EQ(0, ring.overwrite("\x04" "abc", 4, framed_length));
+  EXPECT_EQ(0, ring.overwrite("\x06" "defgh", 6, framed_length));
+  EXPECT_EQ(0, ring.overwrite("\x03" "ij", 3, framed_length));
+  EXPECT_EQ(2, ring.write_capacity());
+
+  // needs 5 slots, so the whole 4 byte "abc" record goes
+  EXPECT_EQ(4, ring.overwrite("\x05" "klmn", 5, framed_length));
+  EXPECT_EQ(1, ring.write_capacity());
+
+  // needs 7 slots, which evicts "defgh" as well
+  EXPECT_EQ(6, ring.overwrite("\x07" "opqrst", 7, framed_length));
+
+  size_t n = ring.read(dst, CAPACITY);
+  ASSERT_EQ(15, n);
+  EXPECT_EQ(0, memcmp(dst, "\x03" "ij" "\x05" "klmn" "\x07" "opqrst", n));
+}
+
+TEST(StaticRingBufferTest, TestOverwrite) {
+  StaticRingBuffer<char, 8> ring;
+  char dst[8];
+
+  EXPECT_EQ(0, ring.overwrite("abcde", 5));
+  EXPECT_EQ(2, ring.overwrite("fghij", 5));
+  ASSERT_EQ(8, ring.read(dst, 8));
+  EXPECT_EQ(0, memcmp(dst, "cdefghij", 8));
+
+  EXPECT_EQ(4, ring.overwrite("0123456789AB", 12));
+  ASSERT_EQ(8, ring.read(dst, 8));
+  EXPECT_EQ(0, memcmp(dst, "456789AB", 8));
+}
+
+TEST(StaticRingBufferTest, TestFullCapacity) {
+  StaticRingBuffer<char, 16> ring;
+  char src[17], dst[17];
+
+  for (int i=0; i < 17; ++i) src[i] = 'a' + i;
+
+  // unlike RingBuffer, every slot can be used
+  EXPECT_EQ(16, ring.write_capacity());
+  EXPECT_EQ(16, ring.write(src, 17));
+  EXPECT_EQ(0, ring.write_capacity());
+  EXPECT_FALSE(ring.put('x'));
+  EXPECT_EQ('a', ring.peek(0));
+  EXPECT_EQ('p', ring.peek(15));
+
+  EXPECT_EQ(16, ring.read(dst, 17));
+  EXPECT_EQ(0, memcmp(src, dst, 16));
+  EXPECT_EQ(0, ring.read_capacity());
+}
+
+TEST(StaticRingBufferTest, TestWrap) {
+  StaticRingBuffer<char, 16> ring;
+  char src[10], dst[10];
+
+  for (int i=0; i < 10; ++i) src[i] = '0' + i;
+
+  for (int pass=0; pass < 5; ++pass) {
+    ASSERT_EQ(10, ring.write(src, 10));
+    EXPECT_EQ(10, ring.read_capacity());
+    EXPECT_EQ('9', ring.peek(9));
+    ASSERT_EQ(10, ring.read(dst, 10));
+    EXPECT_EQ(0, memcmp(src, dst, 10));
+  }
+
+  // 50 elements have gone through, so the data now straddles the end
+  ASSERT_EQ(16, ring.write("abcdefghijklmnop", 16));
+  EXPECT_EQ(14, ring.contiguous_read_capacity());
+
+  RingSpans<char> spans = ring.peek_read();
+  EXPECT_EQ(14, spans.first.length);
+  EXPECT_EQ(2, spans.second.length);
+  EXPECT_EQ(0, memcmp(spans.first.data, "abcdefghijklmn", 14));
+  EXPECT_EQ(0, memcmp(spans.second.data, "op", 2));
+  ring.consume(16);
+
+  spans = ring.reserve_write(100);
+  EXPECT_EQ(16, spans.length());
+  ring.commit_write(3);
+  EXPECT_EQ(3, ring.read_capacity());
+}
+
+TEST(StaticRingBufferTest, TestFreeRunningIndices) {
+  StaticRingBuffer<uint8_t, 4> ring;
+  uint8_t x;
+
+  // the free-running indices go far past N and are only ever masked
+  for (unsigned i=0; i < 1000; ++i) {
+    ASSERT_TRUE(ring.put((uint8_t) i));
+    ASSERT_TRUE(ring.get(x));
+    ASSERT_EQ((uint8_t) i, x);
+  }
+
+  EXPECT_EQ(0, ring.read_capacity());
+}
+
+class SPSCRingBufferTest : public ::testing::Test {
+protected:
+  enum {CAPACITY = 16};
+  char storage[CAPACITY];
+
+  SPSCRingBufferTest() :
+    ring(storage, CAPACITY)
+  {
+  }
+
+  SPSCRingBuffer<char> ring;
+};
+
+TEST_F(SPSCRingBufferTest, TestFill) {
+  char src[CAPACITY], dst[CAPACITY];
+
+  for (int i=0; i < CAPACITY; ++i) src[i] = 'a' + i;
+
+  EXPECT_EQ(CAPACITY-1, ring.write_capacity());
+  EXPECT_EQ(CAPACITY-1, ring.write(src, CAPACITY));
+  EXPECT_EQ(0, ring.write_capacity());
+  EXPECT_FALSE(ring.put('x'));
+
+  EXPECT_EQ(CAPACITY-1, ring.read(dst, CAPACITY));
+  EXPECT_EQ(0, memcmp(src, dst, CAPACITY-1));
+  EXPECT_EQ(0, ring.read_capacity());
+}
+
+TEST_F(SPSCRingBufferTest, TestWrap) {
+  char src[10], dst[10];
+
+  for (int i=0; i < 10; ++i) src[i] = '0' + i;
+
+  for (int pass=0; pass < 5; ++pass) {
+    ASSERT_EQ(10, ring.write(src, 10));
+    EXPECT_EQ(10, ring.read_capacity());
+    EXPECT_EQ('9', ring.peek(9));
+    ASSERT_EQ(10, ring.read(dst, 10));
+    EXPECT_EQ(0, memcmp(src, dst, 10));
+  }
+}
+
+TEST_F(SPSCRingBufferTest, TestPutGet) {
+  char c;
+
+  EXPECT_FALSE(ring.get(c));
+  EXPECT_TRUE(ring.put('a'));
+  EXPECT_TRUE(ring.put('b'));
+  EXPECT_EQ(2, ring.read_capacity());
+  EXPECT_TRUE(ring.get(c));
+  EXPECT_EQ('a', c);
+  EXPECT_TRUE(ring.get(c));
+  EXPECT_EQ('b', c);
+  EXPECT_FALSE(ring.get(c));
+}
+
+// One thread produces a known sequence, another consumes and checks it.
+// Any lost, duplicated or torn element shows up as a sequence mismatch.
+TEST(SPSCRingBufferStressTest, TestTwoThreads) {
+  enum {CAPACITY = 61, COUNT = 1000000}; // odd size exercises uneven runs
+  uint32_t storage[CAPACITY];
+  SPSCRingBuffer<uint32_t> ring(storage, CAPACITY);
+  uint32_t mismatches = 0;
+
+  std::thread producer([&ring]() {
+    uint32_t block[7];
+    uint32_t next = 0;
+
+    while (next < COUNT) {
+      size_t n = 0;
+
+      if (next & 1) {
+        n = ring.put(next) ? 1 : 0;
+      } else {
+        while (n < 7 && next + n < COUNT) block[n] = next + n, ++n;
+        n = ring.write(block, n);
+      }
+
+      if (n == 0) std::this_thread::yield(); // full
+      next += n;
+    }
+  });
+
+  std::thread consumer([&ring, &mismatches]() {
+    uint32_t block[5];
+    uint32_t expected = 0;
+
+    while (expected < COUNT) {
+      size_t n = ring.read(block, 5);
+
+      if (n == 0) std::this_thread::yield(); // empty
+      for (size_t i=0; i < n; ++i) {
+        if (block[i] != expected++) mismatches += 1;
+      }
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  EXPECT_EQ(0, mismatches);
+  EXPECT_EQ(0, ring.read_capacity());
+}